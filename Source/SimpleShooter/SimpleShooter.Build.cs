@@ -21,7 +21,7 @@ public class SimpleShooter : ModuleRules
 			"Slate"
 		});
 
-		PrivateDependencyModuleNames.AddRange(new string[] { });
+		PrivateDependencyModuleNames.AddRange(new string[] { "PhysicsCore", "Chaos", "Niagara" });
 
 		PublicIncludePaths.AddRange(new string[] {
 			"SimpleShooter",
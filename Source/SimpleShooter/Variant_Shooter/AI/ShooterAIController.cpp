@@ -3,8 +3,12 @@
 
 #include "Variant_Shooter/AI/ShooterAIController.h"
 #include "ShooterNPC.h"
+#include "ShooterAILOD.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
 #include "Components/StateTreeAIComponent.h"
 #include "Perception/AIPerceptionComponent.h"
+#include "Perception/AISense_Sight.h"
 #include "Navigation/PathFollowingComponent.h"
 #include "AI/Navigation/PathFollowingAgentInterface.h"
 
@@ -66,6 +70,33 @@ void AShooterAIController::ClearCurrentTarget()
 	TargetEnemy = nullptr;
 }
 
+void AShooterAIController::ApplyLODSettings(const FShooterAILODSettings& Settings, float TickPhase)
+{
+	// delay the next tick by a fraction of the interval first, then keep that offset for every tick after it
+	auto SetStaggeredTickInterval = [TickPhase](UActorComponent* Component, float TickInterval)
+	{
+		if (Component)
+		{
+			Component->SetComponentTickIntervalAndCooldown(TickInterval * TickPhase);
+			Component->SetComponentTickInterval(TickInterval);
+		}
+	};
+
+	SetStaggeredTickInterval(StateTreeAI, Settings.StateTreeTickInterval);
+	SetStaggeredTickInterval(GetPathFollowingComponent(), Settings.MovementTickInterval);
+
+	if (const ACharacter* PossessedCharacter = GetPawn<ACharacter>())
+	{
+		SetStaggeredTickInterval(PossessedCharacter->GetCharacterMovement(), Settings.MovementTickInterval);
+	}
+
+	// the perception system runs sight queries for every listener regardless of the component's tick, so turn the sense itself off
+	if (AIPerception)
+	{
+		AIPerception->SetSenseEnabled(UAISense_Sight::StaticClass(), Settings.bSightEnabled);
+	}
+}
+
 void AShooterAIController::OnPerceptionUpdated(AActor* Actor, FAIStimulus Stimulus)
 {
 	// pass the data to the StateTree delegate hook
@@ -9,6 +9,7 @@
 class UStateTreeAIComponent;
 class UAIPerceptionComponent;
 struct FAIStimulus;
+struct FShooterAILODSettings;
 
 DECLARE_DELEGATE_TwoParams(FShooterPerceptionUpdatedDelegate, AActor*, const FAIStimulus&);
 DECLARE_DELEGATE_OneParam(FShooterPerceptionForgottenDelegate, AActor*);
@@ -73,6 +74,9 @@ public:
 	/** Returns the targeted enemy */
 	AActor* GetCurrentTarget() const { return TargetEnemy; };
 
+	/** Applies the update rates of an AI LOD tier to the StateTree and the pawn's movement, and switches sight on or off. Reduced rate updates are offset by a fraction of their interval */
+	void ApplyLODSettings(const FShooterAILODSettings& Settings, float TickPhase);
+
 protected:
 
 	/** Called when the AI perception component updates a perception on a given actor */
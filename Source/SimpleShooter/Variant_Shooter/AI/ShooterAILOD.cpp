@@ -0,0 +1,205 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterAILOD.h"
+#include "ShooterNPC.h"
+#include "ShooterAIController.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "SimpleShooter.h"
+
+static TAutoConsoleVariable<int32> CVarShooterAILODEnabled(
+	TEXT("Shooter.AILOD.Enabled"),
+	1,
+	TEXT("If 0, every NPC is kept in the engaged tier and updates at full rate"),
+	ECVF_Default);
+
+bool UShooterAILOD::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterAILOD::Deinitialize()
+{
+	Entries.Empty();
+	ViewPoints.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterAILOD::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterAILOD, STATGROUP_Tickables);
+}
+
+void UShooterAILOD::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterAILOD::Tick);
+
+	// only the server registers NPCs
+	if (Entries.Num() == 0 || TierSettings.Num() == 0)
+	{
+		return;
+	}
+
+	GatherViewPoints();
+
+	// evaluate a slice of the NPCs, picking up where the last frame left off
+	const int32 NumEvaluations = FMath::Min(FMath::Max(MaxEvaluationsPerFrame, 1), Entries.Num());
+
+	for (int32 i = 0; i < NumEvaluations && Entries.Num() > 0; ++i)
+	{
+		if (NextEvaluation >= Entries.Num())
+		{
+			NextEvaluation = 0;
+		}
+
+		FShooterAILODEntry& Entry = Entries[NextEvaluation];
+		AShooterNPC* NPC = Entry.NPC.Get();
+
+		// drop NPCs that went away without unregistering
+		if (!NPC)
+		{
+			Entries.RemoveAtSwap(NextEvaluation);
+			continue;
+		}
+
+		++NextEvaluation;
+
+		// dead NPCs lose their controller, so there's nothing left to update
+		AShooterAIController* Controller = NPC->GetController<AShooterAIController>();
+
+		if (!Controller)
+		{
+			continue;
+		}
+
+		const EShooterAILOD Tier = EvaluateTier(NPC);
+
+		if (Entry.Tier.IsSet() && Entry.Tier.GetValue() == Tier)
+		{
+			continue;
+		}
+
+		const int32 TierIndex = FMath::Min(static_cast<int32>(Tier), TierSettings.Num() - 1);
+
+		Controller->ApplyLODSettings(TierSettings[TierIndex], Entry.TickPhase);
+		Entry.Tier = Tier;
+
+		UE_LOG(LogSimpleShooter, Verbose, TEXT("ShooterAILOD: %s moved to %s"), *NPC->GetName(), *UEnum::GetValueAsString(Tier));
+	}
+}
+
+void UShooterAILOD::RegisterNPC(AShooterNPC* NPC)
+{
+	if (!NPC)
+	{
+		return;
+	}
+
+	// hand out phases round robin, so NPCs in the same tier tick on different frames
+	const int32 Buckets = FMath::Max(StaggerBuckets, 1);
+
+	FShooterAILODEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.NPC = NPC;
+	Entry.TickPhase = static_cast<float>(NumRegistered % Buckets + 1) / Buckets;
+
+	++NumRegistered;
+}
+
+void UShooterAILOD::UnregisterNPC(AShooterNPC* NPC)
+{
+	const int32 Index = Entries.IndexOfByPredicate([NPC](const FShooterAILODEntry& Entry) { return Entry.NPC.Get() == NPC; });
+
+	if (Index != INDEX_NONE)
+	{
+		Entries.RemoveAtSwap(Index);
+	}
+}
+
+void UShooterAILOD::GatherViewPoints()
+{
+	ViewPoints.Reset();
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+
+		// spectators and dead players have nothing for the AI to react to
+		if (!PlayerController || !PlayerController->GetPawn())
+		{
+			continue;
+		}
+
+		FVector Location;
+		FRotator Rotation;
+		PlayerController->GetPlayerViewPoint(Location, Rotation);
+
+		ViewPoints.Emplace(Rotation, Location);
+	}
+}
+
+EShooterAILOD UShooterAILOD::EvaluateTier(const AShooterNPC* NPC) const
+{
+	if (!CVarShooterAILODEnabled.GetValueOnGameThread())
+	{
+		return EShooterAILOD::Engaged;
+	}
+
+	// fighting NPCs always run at full rate
+	const AShooterAIController* Controller = NPC->GetController<AShooterAIController>();
+
+	if (Controller && Controller->GetCurrentTarget())
+	{
+		return EShooterAILOD::Engaged;
+	}
+
+	const int32 LastTier = FMath::Min(TierSettings.Num() - 1, static_cast<int32>(EShooterAILOD::Dormant));
+
+	// with no players around there's nothing to engage
+	if (ViewPoints.Num() == 0)
+	{
+		return static_cast<EShooterAILOD>(LastTier);
+	}
+
+	const FVector NPCLocation = NPC->GetActorLocation();
+	const float MinViewDot = FMath::Cos(FMath::DegreesToRadians(ViewConeHalfAngle));
+
+	float NearestDistanceSquared = MAX_flt;
+	bool bInView = false;
+
+	for (const FTransform& ViewPoint : ViewPoints)
+	{
+		const FVector ToNPC = NPCLocation - ViewPoint.GetLocation();
+
+		NearestDistanceSquared = FMath::Min(NearestDistanceSquared, ToNPC.SizeSquared());
+
+		if (!bInView && FVector::DotProduct(ToNPC.GetSafeNormal(), ViewPoint.GetRotation().GetForwardVector()) >= MinViewDot)
+		{
+			bInView = true;
+		}
+	}
+
+	// pick the first tier that reaches the nearest player
+	int32 TierIndex = LastTier;
+
+	for (int32 i = 0; i < LastTier; ++i)
+	{
+		if (NearestDistanceSquared <= FMath::Square(TierSettings[i].MaxDistance))
+		{
+			TierIndex = i;
+			break;
+		}
+	}
+
+	// nobody is looking this way, so it can afford to react a little later
+	if (!bInView)
+	{
+		TierIndex = FMath::Min(TierIndex + 1, LastTier);
+	}
+
+	return static_cast<EShooterAILOD>(TierIndex);
+}
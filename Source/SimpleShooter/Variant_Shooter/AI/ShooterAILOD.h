@@ -0,0 +1,144 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterAILOD.generated.h"
+
+class AShooterNPC;
+
+/**
+ *  AI level of detail tiers, from full rate to barely updated
+ */
+UENUM()
+enum class EShooterAILOD : uint8
+{
+	/** Fighting, or close to a player */
+	Engaged,
+
+	/** Close enough to engage soon */
+	Near,
+
+	/** Far from every player */
+	Far,
+
+	/** Out of every player's reach */
+	Dormant
+};
+
+/**
+ *  Update rates applied to NPCs in an AI LOD tier
+ */
+USTRUCT()
+struct FShooterAILODSettings
+{
+	GENERATED_BODY()
+
+	/** Max distance to the nearest player for an NPC to be put in this tier */
+	UPROPERTY(EditAnywhere, meta = (Units = "cm"))
+	float MaxDistance = 0.0f;
+
+	/** Time between StateTree ticks. 0 ticks every frame */
+	UPROPERTY(EditAnywhere, meta = (Units = "s"))
+	float StateTreeTickInterval = 0.0f;
+
+	/** Time between character movement and path following updates. 0 moves every frame */
+	UPROPERTY(EditAnywhere, meta = (Units = "s"))
+	float MovementTickInterval = 0.0f;
+
+	/** If false, the NPC's sight sense is switched off so the perception system stops tracing for it. Hearing stays on */
+	UPROPERTY(EditAnywhere)
+	bool bSightEnabled = true;
+};
+
+/**
+ *  NPC tracked by the AI LOD manager
+ */
+struct FShooterAILODEntry
+{
+	/** Tracked NPC */
+	TWeakObjectPtr<AShooterNPC> NPC;
+
+	/** Tier currently applied. Unset until the first evaluation */
+	TOptional<EShooterAILOD> Tier;
+
+	/** Fraction of a tick interval this NPC's reduced rate updates are offset by, so they don't all land on the same frame */
+	float TickPhase = 1.0f;
+};
+
+/**
+ *  Server side AI level of detail manager
+ *  Puts each registered NPC in a tier from its distance to the nearest player and whether any player is looking its way.
+ *  NPCs with a target are always engaged. The tier sets the rate the NPC's StateTree and movement update at and whether
+ *  it looks for players, so server AI cost follows the number of engaged NPCs rather than the total.
+ *  A few NPCs are evaluated per frame, and reduced rate updates are phase shifted across frames to avoid spikes
+ */
+UCLASS(Config=Game)
+class SIMPLESHOOTER_API UShooterAILOD : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Update rates for each tier, indexed by EShooterAILOD. The last tier covers every distance past the others */
+	UPROPERTY(Config)
+	TArray<FShooterAILODSettings> TierSettings = {
+		{ 2500.0f, 0.0f, 0.0f, true },
+		{ 5000.0f, 0.1f, 0.0f, true },
+		{ 10000.0f, 0.25f, 0.05f, true },
+		{ 0.0f, 1.0f, 0.2f, false }
+	};
+
+	/** Half-angle of the player view cone. NPCs outside every player's view drop one tier */
+	UPROPERTY(Config)
+	float ViewConeHalfAngle = 60.0f;
+
+	/** Max number of NPCs evaluated per frame */
+	UPROPERTY(Config)
+	int32 MaxEvaluationsPerFrame = 16;
+
+	/** Number of frame offsets reduced rate updates are spread over */
+	UPROPERTY(Config)
+	int32 StaggerBuckets = 4;
+
+	/** Registered NPCs */
+	TArray<FShooterAILODEntry> Entries;
+
+	/** Index of the next entry to evaluate */
+	int32 NextEvaluation = 0;
+
+	/** Number of NPCs registered so far, used to hand out tick phases */
+	int32 NumRegistered = 0;
+
+	/** Player view points gathered for this frame's evaluations */
+	TArray<FTransform> ViewPoints;
+
+protected:
+
+	/** Only create the subsystem for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Evaluates the next few NPCs */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns the stat ID for tick profiling */
+	virtual TStatId GetStatId() const override;
+
+	/** Starts managing the update rates of the given NPC. Server only */
+	void RegisterNPC(AShooterNPC* NPC);
+
+	/** Stops managing the given NPC */
+	void UnregisterNPC(AShooterNPC* NPC);
+
+protected:
+
+	/** Gathers the view point of every player with a pawn */
+	void GatherViewPoints();
+
+	/** Picks the tier for an NPC from its target and the gathered view points */
+	EShooterAILOD EvaluateTier(const AShooterNPC* NPC) const;
+};
@@ -0,0 +1,259 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterLineOfSight.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "SimpleShooter.h"
+
+static FAutoConsoleCommandWithWorld CVarShooterLineOfSightStats(
+	TEXT("Shooter.LineOfSight.Stats"),
+	TEXT("Logs how many line of sight queries were answered from the cache, and how many traces were run"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UShooterLineOfSight* LineOfSight = World->GetSubsystem<UShooterLineOfSight>())
+		{
+			LineOfSight->LogStats();
+		}
+	})
+);
+
+bool UShooterLineOfSight::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterLineOfSight::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TraceDelegate.BindUObject(this, &UShooterLineOfSight::OnTraceCompleted);
+}
+
+void UShooterLineOfSight::Deinitialize()
+{
+	TraceDelegate.Unbind();
+
+	// report how the cache did
+	if (Stats.CacheHits > 0 || Stats.CacheMisses > 0)
+	{
+		LogStats();
+	}
+
+	Requests.Empty();
+	InFlight.Empty();
+	DirectCache.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterLineOfSight::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterLineOfSight, STATGROUP_Tickables);
+}
+
+void UShooterLineOfSight::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterLineOfSight::Tick);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	for (auto It = Requests.CreateIterator(); It; ++It)
+	{
+		FShooterLineOfSightRequest& Request = It.Value();
+
+		// drop requests nobody has renewed, or whose actors are gone
+		if (Now - Request.RequestTime > RequestLifetime || !Request.Viewer.IsValid() || !Request.Target.IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		// wait for the previous batch to come back before sending another
+		if (!Request.bRequested || Request.PendingTraces > 0)
+		{
+			continue;
+		}
+
+		// neither end has moved enough to change the answer
+		if (Request.bHasResult && IsCacheValid(Request.Result, Request.Start, Request.Target->GetActorLocation(), Request.NumChecks, Now))
+		{
+			Request.bRequested = false;
+			continue;
+		}
+
+		DispatchRequest(Request, It.Key());
+	}
+
+	// drop direct results too old to be used again
+	for (auto It = DirectCache.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value().Time > CacheLifetime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+bool UShooterLineOfSight::RequestLineOfSight(const AActor* Viewer, const FVector& Start, const AActor* Target, int32 NumChecks, bool& bOutHasLineOfSight)
+{
+	FShooterLineOfSightRequest& Request = Requests.FindOrAdd(TPair<FObjectKey, FObjectKey>(Viewer, Target));
+
+	// renew the request. It's traced with the latest eye location at the end of the frame
+	Request.Viewer = Viewer;
+	Request.Target = Target;
+	Request.Start = Start;
+	Request.NumChecks = NumChecks;
+	Request.RequestTime = GetWorld()->GetTimeSeconds();
+	Request.bRequested = true;
+
+	// count the query against the result it's answered with
+	if (Request.bHasResult && IsCacheValid(Request.Result, Start, Target->GetActorLocation(), NumChecks, Request.RequestTime))
+	{
+		++Stats.CacheHits;
+
+	} else {
+
+		++Stats.CacheMisses;
+	}
+
+	bOutHasLineOfSight = Request.Result.bHasLineOfSight;
+
+	return Request.bHasResult;
+}
+
+bool UShooterLineOfSight::TestLineOfSight(const AActor* Viewer, const FVector& Start, const AActor* Target, const FVector& End)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	FShooterLineOfSightCacheEntry& Entry = DirectCache.FindOrAdd(TPair<FObjectKey, FObjectKey>(Viewer, Target), FShooterLineOfSightCacheEntry { FVector::ZeroVector, FVector::ZeroVector, -MAX_flt, 1, false });
+
+	if (IsCacheValid(Entry, Start, End, 1, Now))
+	{
+		++Stats.CacheHits;
+		return Entry.bHasLineOfSight;
+	}
+
+	++Stats.CacheMisses;
+	++Stats.Traces;
+
+	// ignore the viewer and target. We want to ensure there's an unobstructed trace not counting them
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterLineOfSight), false);
+	QueryParams.AddIgnoredActor(Viewer);
+	QueryParams.AddIgnoredActor(Target);
+
+	FHitResult OutHit;
+
+	Entry.Start = Start;
+	Entry.End = End;
+	Entry.Time = Now;
+	Entry.bHasLineOfSight = !GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, TraceChannel, QueryParams);
+
+	return Entry.bHasLineOfSight;
+}
+
+void UShooterLineOfSight::LogStats() const
+{
+	const int32 Queries = Stats.CacheHits + Stats.CacheMisses;
+	const float HitRate = Queries > 0 ? 100.0f * Stats.CacheHits / Queries : 0.0f;
+
+	UE_LOG(LogSimpleShooter, Log, TEXT("Line of sight cache: hits %d, misses %d (%.1f%% hit rate), traces %d"), Stats.CacheHits, Stats.CacheMisses, HitRate, Stats.Traces);
+}
+
+bool UShooterLineOfSight::IsCacheValid(const FShooterLineOfSightCacheEntry& Entry, const FVector& Start, const FVector& End, int32 NumChecks, float Now) const
+{
+	// a different number of checks traces to different points
+	if (Entry.NumChecks != NumChecks || Now - Entry.Time > CacheLifetime)
+	{
+		return false;
+	}
+
+	const float ThresholdSquared = FMath::Square(CacheMoveThreshold);
+
+	return FVector::DistSquared(Entry.Start, Start) <= ThresholdSquared && FVector::DistSquared(Entry.End, End) <= ThresholdSquared;
+}
+
+void UShooterLineOfSight::DispatchRequest(FShooterLineOfSightRequest& Request, const TPair<FObjectKey, FObjectKey>& Key)
+{
+	const AActor* Viewer = Request.Viewer.Get();
+	const AActor* Target = Request.Target.Get();
+
+	Request.bRequested = false;
+
+	// remember what we traced between, so the result can be reused until either end moves
+	Request.Pending.Start = Request.Start;
+	Request.Pending.End = Target->GetActorLocation();
+	Request.Pending.Time = GetWorld()->GetTimeSeconds();
+	Request.Pending.NumChecks = Request.NumChecks;
+
+	// too few checks to trace anything never has line of sight
+	if (Request.NumChecks < 2)
+	{
+		Request.Result = Request.Pending;
+		Request.Result.bHasLineOfSight = false;
+		Request.bHasResult = true;
+		return;
+	}
+
+	// get the target's bounding box
+	FVector CenterOfMass, Extent;
+	Target->GetActorBounds(true, CenterOfMass, Extent, false);
+
+	// divide the vertical extent by the number of line of sight checks we'll do
+	const int32 NumChecks = Request.NumChecks;
+	const float ExtentZOffset = Extent.Z * 2.0f / NumChecks;
+
+	// ignore the viewer and target. We want to ensure there's an unobstructed trace not counting them
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterLineOfSight), false);
+	QueryParams.AddIgnoredActor(Viewer);
+	QueryParams.AddIgnoredActor(Target);
+
+	const uint32 BatchId = NextBatchId++;
+	InFlight.Add(BatchId, Key);
+
+	Request.BatchId = BatchId;
+	Request.PendingTraces = NumChecks - 1;
+	Stats.Traces += NumChecks - 1;
+	Request.bPendingClear = false;
+
+	// trace to a number of vertically offset points on the target
+	for (int32 i = 0; i < NumChecks - 1; ++i)
+	{
+		const FVector End = CenterOfMass + FVector(0.0f, 0.0f, Extent.Z - ExtentZOffset * i);
+
+		GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Request.Start, End, TraceChannel, QueryParams, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, BatchId);
+	}
+}
+
+void UShooterLineOfSight::OnTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	const TPair<FObjectKey, FObjectKey>* Key = InFlight.Find(Datum.UserData);
+
+	// the request may have expired, or been made again, while its traces were in flight
+	FShooterLineOfSightRequest* Request = Key ? Requests.Find(*Key) : nullptr;
+
+	if (!Request || Request->BatchId != Datum.UserData || Request->PendingTraces <= 0)
+	{
+		InFlight.Remove(Datum.UserData);
+		return;
+	}
+
+	// a single unobstructed trace is enough
+	if (Datum.OutHits.Num() == 0 || !Datum.OutHits[0].bBlockingHit)
+	{
+		Request->bPendingClear = true;
+	}
+
+	// publish once the whole batch is back
+	if (--Request->PendingTraces <= 0)
+	{
+		Request->PendingTraces = 0;
+		Request->Result = Request->Pending;
+		Request->Result.bHasLineOfSight = Request->bPendingClear;
+		Request->bHasResult = true;
+
+		InFlight.Remove(Datum.UserData);
+	}
+}
@@ -0,0 +1,180 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "UObject/ObjectKey.h"
+#include "ShooterLineOfSight.generated.h"
+
+/**
+ *  Line of sight result cached with the endpoints it was traced between
+ */
+struct FShooterLineOfSightCacheEntry
+{
+	/** Eye location the result was traced from */
+	FVector Start = FVector::ZeroVector;
+
+	/** Target location when the result was traced */
+	FVector End = FVector::ZeroVector;
+
+	/** Game time the result was traced at */
+	float Time = 0.0f;
+
+	/** Number of vertical slices of the target the result was traced to */
+	int32 NumChecks = 0;
+
+	/** If true, the target was visible */
+	bool bHasLineOfSight = false;
+};
+
+/**
+ *  Counters describing how many line of sight traces the cache saved
+ */
+struct FShooterLineOfSightStats
+{
+	/** Queries whose latest result still held for their endpoints and checks */
+	int32 CacheHits = 0;
+
+	/** Queries with no result yet, or one that no longer held */
+	int32 CacheMisses = 0;
+
+	/** Line traces run, sync or async */
+	int32 Traces = 0;
+};
+
+/**
+ *  Line of sight request from a viewer to a target, and its latest result
+ */
+struct FShooterLineOfSightRequest
+{
+	/** Actor looking */
+	TWeakObjectPtr<const AActor> Viewer;
+
+	/** Actor being looked at */
+	TWeakObjectPtr<const AActor> Target;
+
+	/** Eye location of the viewer, from the latest request */
+	FVector Start = FVector::ZeroVector;
+
+	/** Result of the latest completed batch, with the endpoints it was traced between */
+	FShooterLineOfSightCacheEntry Result;
+
+	/** Endpoints and time of the batch in flight */
+	FShooterLineOfSightCacheEntry Pending;
+
+	/** Number of vertical slices of the target's bounds to trace to */
+	int32 NumChecks = 0;
+
+	/** Game time of the latest request */
+	float RequestTime = 0.0f;
+
+	/** If true, the request was renewed since its last batch was dispatched */
+	bool bRequested = false;
+
+	/** User data of the batch in flight */
+	uint32 BatchId = 0;
+
+	/** Number of traces dispatched and not completed yet */
+	int32 PendingTraces = 0;
+
+	/** If true, one of the pending traces has reached the target */
+	bool bPendingClear = false;
+
+	/** If true, a batch of traces has completed and the result is valid */
+	bool bHasResult = false;
+};
+
+/**
+ *  Batched asynchronous line of sight service
+ *  Callers submit requests and read back the most recent result. Requests made during a frame are gathered
+ *  and dispatched together at the end of it as async traces, which run on worker threads and report back
+ *  at the start of the next frame, before the AI evaluates again. Requests that aren't renewed expire.
+ *  Results are cached per viewer and target with the endpoints they were traced between, and only traced
+ *  again once either endpoint moves past a threshold or the result gets too old
+ */
+UCLASS(Config=Game)
+class SIMPLESHOOTER_API UShooterLineOfSight : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Collision channel line of sight is traced on */
+	UPROPERTY(Config)
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** Time a request is kept alive without being renewed */
+	UPROPERTY(Config)
+	float RequestLifetime = 1.0f;
+
+	/** Distance either endpoint can move before a cached result is traced again */
+	UPROPERTY(Config)
+	float CacheMoveThreshold = 25.0f;
+
+	/** Max age of a cached result */
+	UPROPERTY(Config)
+	float CacheLifetime = 0.5f;
+
+	/** Cached results of direct line of sight tests, by viewer and target */
+	TMap<TPair<FObjectKey, FObjectKey>, FShooterLineOfSightCacheEntry> DirectCache;
+
+	/** Cache hit and miss counters */
+	FShooterLineOfSightStats Stats;
+
+	/** Requests by viewer and target */
+	TMap<TPair<FObjectKey, FObjectKey>, FShooterLineOfSightRequest> Requests;
+
+	/** Keys of the requests with traces in flight, indexed by the trace user data */
+	TMap<uint32, TPair<FObjectKey, FObjectKey>> InFlight;
+
+	/** User data to tag the next dispatched batch with */
+	uint32 NextBatchId = 0;
+
+	/** Called by the world as each async trace completes */
+	FTraceDelegate TraceDelegate;
+
+protected:
+
+	/** Only create the subsystem for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Binds the trace delegate */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Dispatches this frame's requests and expires abandoned ones */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns the stat ID for tick profiling */
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 *  Requests line of sight from a viewer's eye location to several heights of a target, and returns the latest result
+	 *  Returns false if no batch has completed for this viewer and target yet
+	 */
+	bool RequestLineOfSight(const AActor* Viewer, const FVector& Start, const AActor* Target, int32 NumChecks, bool& bOutHasLineOfSight);
+
+	/** Returns true if there's nothing blocking a single line between the given points, ignoring the viewer and target. Traced right away on a cache miss */
+	bool TestLineOfSight(const AActor* Viewer, const FVector& Start, const AActor* Target, const FVector& End);
+
+	/** Returns the cache counters */
+	const FShooterLineOfSightStats& GetStats() const { return Stats; };
+
+	/** Logs the cache counters */
+	void LogStats() const;
+
+protected:
+
+	/** Returns true if a cached result still holds for the given endpoints and number of checks */
+	bool IsCacheValid(const FShooterLineOfSightCacheEntry& Entry, const FVector& Start, const FVector& End, int32 NumChecks, float Now) const;
+
+	/** Issues the async traces for a request */
+	void DispatchRequest(FShooterLineOfSightRequest& Request, const TPair<FObjectKey, FObjectKey>& Key);
+
+	/** Folds a completed trace into its request's result */
+	void OnTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Datum);
+};
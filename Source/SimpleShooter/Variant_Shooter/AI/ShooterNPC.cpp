@@ -3,9 +3,10 @@
 
 #include "Variant_Shooter/AI/ShooterNPC.h"
 #include "ShooterWeapon.h"
+#include "ShooterLagCompensation.h"
+#include "ShooterAILOD.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Camera/CameraComponent.h"
-#include "Kismet/KismetMathLibrary.h"
 #include "Engine/World.h"
 #include "ShooterGameMode.h"
 #include "Components/CapsuleComponent.h"
@@ -24,6 +25,27 @@ void AShooterNPC::BeginPlay()
 	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 
 	Weapon = GetWorld()->SpawnActor<AShooterWeapon>(WeaponClass, GetActorTransform(), SpawnParams);
+
+	// record our capsule so shots can be validated against where remote players saw us
+	if (HasAuthority())
+	{
+		// seed the aim error we use while unarmed from the game mode, so it repeats like armed aim does
+		if (AShooterGameMode* GameMode = GetWorld()->GetAuthGameMode<AShooterGameMode>())
+		{
+			FallbackAimStream.Initialize(GameMode->MakeRandomSeed());
+		}
+
+		if (UShooterLagCompensation* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensation>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+
+		// let the AI LOD manager scale our update rates with how close the players are
+		if (UShooterAILOD* AILOD = GetWorld()->GetSubsystem<UShooterAILOD>())
+		{
+			AILOD->RegisterNPC(this);
+		}
+	}
 }
 
 void AShooterNPC::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -32,6 +54,18 @@ void AShooterNPC::EndPlay(const EEndPlayReason::Type EndPlayReason)
 
 	// clear the death timer
 	GetWorld()->GetTimerManager().ClearTimer(DeathTimer);
+
+	// stop recording our capsule
+	if (UShooterLagCompensation* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensation>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+
+	// stop managing our update rates
+	if (UShooterAILOD* AILOD = GetWorld()->GetSubsystem<UShooterAILOD>())
+	{
+		AILOD->UnregisterNPC(this);
+	}
 }
 
 float AShooterNPC::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
@@ -95,6 +129,10 @@ FVector AShooterNPC::GetWeaponTargetLocation()
 
 	FVector AimDir, AimTarget = FVector::ZeroVector;
 
+	// draw the aim error from the stream of the shot we're about to fire, so the same shot always misses the same way
+	FRandomStream AimStream = Weapon ? Weapon->GetShotStream(Weapon->GetNextShotId(), EShooterShotRandom::OwnerAim) : FRandomStream(static_cast<int32>(FallbackAimStream.GetUnsignedInt()));
+	const float AimVarianceRadians = FMath::DegreesToRadians(AimVarianceHalfAngle);
+
 	// do we have an aim target?
 	if (CurrentAimTarget)
 	{
@@ -102,17 +140,17 @@ FVector AShooterNPC::GetWeaponTargetLocation()
 		AimTarget = CurrentAimTarget->GetActorLocation();
 
 		// apply a vertical offset to target head/feet
-		AimTarget.Z += FMath::RandRange(MinAimOffsetZ, MaxAimOffsetZ);
+		AimTarget.Z += AimStream.FRandRange(MinAimOffsetZ, MaxAimOffsetZ);
 
 		// get the aim direction and apply randomness in a cone
 		AimDir = (AimTarget - AimSource).GetSafeNormal();
-		AimDir = UKismetMathLibrary::RandomUnitVectorInConeInDegrees(AimDir, AimVarianceHalfAngle);
+		AimDir = AimStream.VRandCone(AimDir, AimVarianceRadians);
 
 		
 	} else {
 
 		// no aim target, so just use the camera facing
-		AimDir = UKismetMathLibrary::RandomUnitVectorInConeInDegrees(GetFirstPersonCameraComponent()->GetForwardVector(), AimVarianceHalfAngle);
+		AimDir = AimStream.VRandCone(GetFirstPersonCameraComponent()->GetForwardVector(), AimVarianceRadians);
 
 	}
 
@@ -72,6 +72,9 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Aim")
 	float MaxAimOffsetZ = -60.0f;
 
+	/** Aim error stream used when there's no weapon to draw it from */
+	FRandomStream FallbackAimStream;
+
 	/** Actor currently being targeted */
 	TObjectPtr<AActor> CurrentAimTarget;
 
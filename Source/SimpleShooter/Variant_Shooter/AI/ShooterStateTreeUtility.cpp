@@ -8,6 +8,7 @@
 #include "AIController.h"
 #include "Perception/AIPerceptionComponent.h"
 #include "ShooterAIController.h"
+#include "ShooterLineOfSight.h"
 #include "StateTreeAsyncExecutionContext.h"
 
 bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionContext& Context) const
@@ -32,41 +33,26 @@ bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionCo
 		return !InstanceData.bMustHaveLineOfSight;
 	}
 
-	// get the target's bounding box
-	FVector CenterOfMass, Extent;
-	InstanceData.Target->GetActorBounds(true, CenterOfMass, Extent, false);
+	UShooterLineOfSight* LineOfSight = InstanceData.Character->GetWorld()->GetSubsystem<UShooterLineOfSight>();
 
-	// divide the vertical extent by the number of line of sight checks we'll do
-	const float ExtentZOffset = Extent.Z * 2.0f / InstanceData.NumberOfVerticalLineOfSightChecks;
+	if (!LineOfSight)
+	{
+		return !InstanceData.bMustHaveLineOfSight;
+	}
 
 	// get the character's camera location as the source for the line checks
 	const FVector Start = InstanceData.Character->GetFirstPersonCameraComponent()->GetComponentLocation();
 
-	// ignore the character and target. We want to ensure there's an unobstructed trace not counting them
-	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(InstanceData.Character);
-	QueryParams.AddIgnoredActor(InstanceData.Target);
+	// request traces to a number of vertically offset points on the target. They run asynchronously, so read the latest result
+	bool bHasLineOfSight = false;
 
-	FHitResult OutHit;
-
-	// run a number of vertically offset line traces to the target location
-	for (int32 i = 0; i < InstanceData.NumberOfVerticalLineOfSightChecks - 1; ++i)
+	if (!LineOfSight->RequestLineOfSight(InstanceData.Character, Start, InstanceData.Target, InstanceData.NumberOfVerticalLineOfSightChecks, bHasLineOfSight))
 	{
-		// calculate the endpoint for the trace
-		const FVector End = CenterOfMass + FVector(0.0f, 0.0f, Extent.Z - ExtentZOffset * i);
-
-		InstanceData.Character->GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams);
-
-		// is the trace unobstructed?
-		if (!OutHit.bBlockingHit)
-		{
-			// we only need one unobstructed trace, so terminate early
-			return InstanceData.bMustHaveLineOfSight;
-		}
+		// no result yet, so assume we can't see the target until the first batch comes back
+		return !InstanceData.bMustHaveLineOfSight;
 	}
 
-	// no line of sight found
-	return !InstanceData.bMustHaveLineOfSight;
+	return bHasLineOfSight == InstanceData.bMustHaveLineOfSight;
 }
 
 #if WITH_EDITOR
@@ -239,18 +225,13 @@ EStateTreeRunStatus FStateTreeSenseEnemiesTask::EnterState(FStateTreeExecutionCo
 						const float DirDot = FVector::DotProduct(StimulusDir, LambdaInstanceData->Character->GetActorForwardVector());
 						const float MaxDot = FMath::Cos(FMath::DegreesToRadians(LambdaInstanceData->DirectLineOfSightCone));
 
+						UShooterLineOfSight* LineOfSight = LambdaInstanceData->Character->GetWorld()->GetSubsystem<UShooterLineOfSight>();
+
 						// is the direction within our perception cone?
-						if (DirDot >= MaxDot)
+						if (DirDot >= MaxDot && LineOfSight)
 						{
-							// run a line trace between the character and the sensed actor
-							FCollisionQueryParams QueryParams;
-							QueryParams.AddIgnoredActor(LambdaInstanceData->Character);
-							QueryParams.AddIgnoredActor(SensedActor);
-
-							FHitResult OutHit;
-
-							// we have direct line of sight if this trace is unobstructed
-							bDirectLOS = !LambdaInstanceData->Character->GetWorld()->LineTraceSingleByChannel(OutHit, LambdaInstanceData->Character->GetActorLocation(), SensedActor->GetActorLocation(), ECC_Visibility, QueryParams);
+							// we have direct line of sight if a line between the character and the sensed actor is unobstructed. Reuses the last trace if neither has moved
+							bDirectLOS = LineOfSight->TestLineOfSight(LambdaInstanceData->Character, LambdaInstanceData->Character->GetActorLocation(), SensedActor, SensedActor->GetActorLocation());
 
 						}
 
@@ -3,15 +3,18 @@
 
 #include "ShooterCharacter.h"
 #include "ShooterWeapon.h"
+#include "ShooterLagCompensation.h"
 #include "EnhancedInputComponent.h"
 #include "Components/InputComponent.h"
 #include "Components/PawnNoiseEmitterComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
 #include "Camera/CameraComponent.h"
 #include "TimerManager.h"
 #include "ShooterGameMode.h"
+#include "SimpleShooter.h"
 #include <Net/UnrealNetwork.h>
 
 
@@ -41,6 +44,12 @@ void AShooterCharacter::BeginPlay()
 		{
 			GM->OnGameOver.AddDynamic(this, &AShooterCharacter::OnGameOver);
 		}
+
+		// record our capsule so shots can be validated against where remote players saw us
+		if (UShooterLagCompensation* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensation>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
 	}
 }
 
@@ -50,6 +59,15 @@ void AShooterCharacter::EndPlay(EEndPlayReason::Type EndPlayReason)
 
 	// clear the respawn timer
 	GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
+
+	// stop resending fire input
+	GetWorld()->GetTimerManager().ClearTimer(FireInputResendTimer);
+
+	// stop recording our capsule
+	if (UShooterLagCompensation* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensation>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
 }
 
 void AShooterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -122,7 +140,16 @@ void AShooterCharacter::DoStartFiring()
 		}
 	}
 	else {
-		ServerDoStartFiring();
+		// record the press before the weapon advances its counters, so the server can line its shots up with ours
+		QueueFireInput(true);
+
+		// run the weapon locally so ammo, refire and cooldown never wait on the server
+		if (CurrentWeapon)
+		{
+			CurrentWeapon->StartFiring();
+		}
+
+		SendFireInputs();
 	}
 }
 
@@ -137,65 +164,238 @@ void AShooterCharacter::DoStopFiring()
 		}
 	}
 	else {
-		ServerDoStopFiring();
+		// stop any predicted firing
+		if (CurrentWeapon)
+		{
+			CurrentWeapon->StopFiring();
+		}
+
+		// tell the server when we let go and where our ammo ended up
+		QueueFireInput(false);
+		SendFireInputs();
 	}
 }
 
 void AShooterCharacter::DoSwitchWeapon()
 {
+	// ensure we have at least two weapons two switch between
+	AShooterWeapon* NextWeapon = GetNextWeapon();
+
+	if (!NextWeapon)
+	{
+		return;
+	}
+
 	if (HasAuthority())
 	{
-		// ensure we have at least two weapons two switch between
-		if (OwnedWeapons.Num() > 1)
+		EquipWeapon(NextWeapon);
+	}
+	else {
+		// switch right away and let the server confirm it
+		++WeaponSwitchSequence;
+
+		EquipWeapon(NextWeapon);
+
+		ServerDoSwitchWeapon(NextWeapon, WeaponSwitchSequence);
+	}
+}
+
+AShooterWeapon* AShooterCharacter::GetNextWeapon() const
+{
+	if (OwnedWeapons.Num() < 2)
+	{
+		return nullptr;
+	}
+
+	// find the index of the current weapon in the owned list
+	const int32 WeaponIndex = OwnedWeapons.Find(CurrentWeapon);
+
+	// walk forward from it, looping back to the beginning of the array. Weapons may not have replicated to us yet
+	for (int32 i = 1; i < OwnedWeapons.Num(); ++i)
+	{
+		AShooterWeapon* Weapon = OwnedWeapons[(WeaponIndex + i) % OwnedWeapons.Num()];
+
+		if (IsValid(Weapon) && Weapon != CurrentWeapon)
 		{
-			// deactivate the old weapon
-			CurrentWeapon->DeactivateWeapon();
-
-			// find the index of the current weapon in the owned list
-			int32 WeaponIndex = OwnedWeapons.Find(CurrentWeapon);
-
-			// is this the last weapon?
-			if (WeaponIndex == OwnedWeapons.Num() - 1)
-			{
-				// loop back to the beginning of the array
-				WeaponIndex = 0;
-			}
-			else {
-				// select the next weapon index
-				++WeaponIndex;
-			}
-
-			// set the new weapon as current
-			CurrentWeapon = OwnedWeapons[WeaponIndex];
-
-			// activate the new weapon
-			CurrentWeapon->ActivateWeapon();
+			return Weapon;
 		}
 	}
-	else {
-		ServerDoSwitchWeapon();
+
+	return nullptr;
+}
+
+void AShooterCharacter::EquipWeapon(AShooterWeapon* NewWeapon)
+{
+	if (CurrentWeapon == NewWeapon)
+	{
+		return;
+	}
+
+	// deactivate the old weapon
+	if (IsValid(CurrentWeapon))
+	{
+		CurrentWeapon->DeactivateWeapon();
+	}
+
+	// set the new weapon as current
+	CurrentWeapon = NewWeapon;
+
+	if (HasAuthority())
+	{
+		ServerWeapon = NewWeapon;
+	}
+
+	// activate the new weapon
+	if (IsValid(CurrentWeapon))
+	{
+		CurrentWeapon->ActivateWeapon();
 	}
 }
 
-void AShooterCharacter::ServerDoStartFiring_Implementation()
+void AShooterCharacter::QueueFireInput(bool bPressed)
 {
+	FShooterFireInputEvent& Event = PendingFireInputs.AddDefaulted_GetRef();
+	Event.Sequence = NextFireInputSequence++;
+	Event.bPressed = bPressed;
+	Event.Aim = GetControlRotation();
+
+	// stamp the transition with our estimate of the server clock
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	Event.ClientTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+
 	if (CurrentWeapon)
 	{
-		CurrentWeapon->StartFiring();
+		Event.WeaponId = CurrentWeapon->GetNetWeaponId();
+		Event.FirstShotId = CurrentWeapon->GetNextShotId();
+		Event.FireSequence = CurrentWeapon->GetFireSequence();
+		Event.Bullets = static_cast<uint16>(FMath::Clamp(CurrentWeapon->GetBulletCount(), 0, static_cast<int32>(MAX_uint16)));
+	}
+
+	// keep every transition until it's acknowledged. Only a connection that's been dead for a long while drops one, and the server notices the gap
+	if (PendingFireInputs.Num() > ShooterFireInputMaxPending)
+	{
+		PendingFireInputs.RemoveAt(0, PendingFireInputs.Num() - ShooterFireInputMaxPending);
 	}
 }
 
-void AShooterCharacter::ServerDoStopFiring_Implementation()
+void AShooterCharacter::SendFireInputs()
 {
-	if (CurrentWeapon)
+	// everything we sent has been applied
+	if (PendingFireInputs.Num() == 0)
+	{
+		GetWorld()->GetTimerManager().ClearTimer(FireInputResendTimer);
+		return;
+	}
+
+	// the server applies transitions in order, so send the oldest ones first. Newer ones go out as those get acknowledged
+	FShooterFireInputPacket Packet;
+	Packet.Events.Append(PendingFireInputs.GetData(), FMath::Min(PendingFireInputs.Num(), ShooterFireInputRedundancy));
+
+	ServerFireInput(Packet);
+
+	// keep repeating the transitions until the server acknowledges them, in case this packet is lost
+	if (!GetWorld()->GetTimerManager().IsTimerActive(FireInputResendTimer))
+	{
+		GetWorld()->GetTimerManager().SetTimer(FireInputResendTimer, this, &AShooterCharacter::SendFireInputs, FireInputResendInterval, true);
+	}
+}
+
+void AShooterCharacter::ServerFireInput_Implementation(const FShooterFireInputPacket& Packet)
+{
+	for (const FShooterFireInputEvent& Event : Packet.Events)
 	{
+		// skip transitions we already applied, including the redundant copies of them
+		if (static_cast<int16>(Event.Sequence - AckedFireInput) <= 0)
+		{
+			continue;
+		}
+
+		// the client gave up on some transitions. Carry on from this one, which still has the current trigger state
+		if (Event.Sequence != static_cast<uint16>(AckedFireInput + 1))
+		{
+			UE_LOG(LogSimpleShooter, Warning, TEXT("%s: lost fire inputs %d to %d"), *GetName(), AckedFireInput + 1, Event.Sequence - 1);
+		}
+
+		ApplyFireInput(Event);
+
+		AckedFireInput = Event.Sequence;
+	}
+}
+
+void AShooterCharacter::ApplyFireInput(const FShooterFireInputEvent& Event)
+{
+	// measure how long the transition took to get here, so lag compensation can use it instead of guessing from the ping.
+	// The timestamp comes from the client's clock estimate, so lag compensation bounds it by the round trip we measured
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	UShooterLagCompensation* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensation>();
+
+	if (GameState && LagCompensation)
+	{
+		LagCompensation->ReportInputDelay(this, GameState->GetServerWorldTimeSeconds() - Event.ClientTime);
+	}
+
+	if (!CurrentWeapon)
+	{
+		return;
+	}
+
+	// the client's counters only line up with ours if it was using the same weapon. Weapons without a stable ID can't be matched
+	const bool bSameWeapon = Event.WeaponId != ShooterWeaponIdNone && Event.WeaponId == CurrentWeapon->GetNetWeaponId();
+
+	if (Event.bPressed)
+	{
+		if (bSameWeapon)
+		{
+			// number our shots the same way the client did so its predictions can be matched
+			CurrentWeapon->SetNextShotId(Event.FirstShotId);
+
+			// make sure the client's ammo agrees with ours before the burst
+			CurrentWeapon->ReconcileAmmo(Event.FireSequence, Event.Bullets);
+
+			// fire the first shot exactly where the client aimed it
+			PendingFireAim = Event.Aim;
+		}
+
+		CurrentWeapon->StartFiring();
+
+		PendingFireAim.Reset();
+
+	} else {
+
 		CurrentWeapon->StopFiring();
+
+		// correct whatever the client's ammo drifted by during the burst
+		if (bSameWeapon)
+		{
+			CurrentWeapon->ReconcileAmmo(Event.FireSequence, Event.Bullets);
+		}
 	}
 }
 
-void AShooterCharacter::ServerDoSwitchWeapon_Implementation()
+void AShooterCharacter::OnRep_AckedFireInput()
 {
-	DoSwitchWeapon();
+	PendingFireInputs.RemoveAll([this](const FShooterFireInputEvent& Event)
+	{
+		return static_cast<int16>(Event.Sequence - AckedFireInput) <= 0;
+	});
+
+	// nothing left to resend
+	if (PendingFireInputs.Num() == 0)
+	{
+		GetWorld()->GetTimerManager().ClearTimer(FireInputResendTimer);
+	}
+}
+
+void AShooterCharacter::ServerDoSwitchWeapon_Implementation(AShooterWeapon* Weapon, uint8 Sequence)
+{
+	// only switch to weapons we actually own
+	if (IsValid(Weapon) && OwnedWeapons.Contains(Weapon))
+	{
+		EquipWeapon(Weapon);
+	}
+
+	// answer even if we refused, so the client falls back to our weapon
+	AckedWeaponSwitch = Sequence;
 }
 
 void AShooterCharacter::AttachWeaponMeshes(AShooterWeapon* Weapon)
@@ -208,7 +408,10 @@ void AShooterCharacter::AttachWeaponMeshes(AShooterWeapon* Weapon)
 	// attach the weapon meshes
 	Weapon->GetFirstPersonMesh()->AttachToComponent(GetFirstPersonMesh(), AttachmentRule, FirstPersonWeaponSocket);
 	Weapon->GetThirdPersonMesh()->AttachToComponent(GetMesh(), AttachmentRule, FirstPersonWeaponSocket);
-	
+
+	// work out how the weapon's anim classes go into our meshes now, so switching to it only has to swap them
+	PrepareWeaponAnimClass(GetFirstPersonMesh(), Weapon->GetFirstPersonAnimInstanceClass(), LinkedFirstPersonLayers);
+	PrepareWeaponAnimClass(GetMesh(), Weapon->GetThirdPersonAnimInstanceClass(), LinkedThirdPersonLayers);
 }
 
 void AShooterCharacter::PlayFiringMontage(UAnimMontage* Montage)
@@ -237,7 +440,10 @@ FVector AShooterCharacter::GetWeaponTargetLocation()
 	FHitResult OutHit;
 
 	const FVector Start = GetFirstPersonCameraComponent()->GetComponentLocation();
-	const FVector End = Start + (GetFirstPersonCameraComponent()->GetForwardVector() * MaxAimDistance);
+
+	// the first shot of a remote player's press uses the exact aim it was pressed with
+	const FVector AimDirection = PendingFireAim.IsSet() ? PendingFireAim->Vector() : GetFirstPersonCameraComponent()->GetForwardVector();
+	const FVector End = Start + (AimDirection * MaxAimDistance);
 
 	FCollisionQueryParams QueryParams;
 	QueryParams.AddIgnoredActor(this);
@@ -269,15 +475,8 @@ void AShooterCharacter::AddWeaponClass(const TSubclassOf<AShooterWeapon>& Weapon
 			// add the weapon to the owned list
 			OwnedWeapons.Add(AddedWeapon);
 
-			// if we have an existing weapon, deactivate it
-			if (CurrentWeapon)
-			{
-				CurrentWeapon->DeactivateWeapon();
-			}
-
 			// switch to the new weapon
-			CurrentWeapon = AddedWeapon;
-			CurrentWeapon->ActivateWeapon();
+			EquipWeapon(AddedWeapon);
 		}
 	}
 }
@@ -287,9 +486,69 @@ void AShooterCharacter::OnWeaponActivated(AShooterWeapon* Weapon)
 	// update the bullet counter
 	OnBulletCountUpdated.Broadcast(Weapon->GetMagazineSize(), Weapon->GetBulletCount());
 
-	// set the character mesh AnimInstances
-	GetFirstPersonMesh()->SetAnimInstanceClass(Weapon->GetFirstPersonAnimInstanceClass());
-	GetMesh()->SetAnimInstanceClass(Weapon->GetThirdPersonAnimInstanceClass());
+	// set the character mesh animation
+	ApplyWeaponAnimClass(GetFirstPersonMesh(), Weapon->GetFirstPersonAnimInstanceClass(), LinkedFirstPersonLayers);
+	ApplyWeaponAnimClass(GetMesh(), Weapon->GetThirdPersonAnimInstanceClass(), LinkedThirdPersonLayers);
+}
+
+void AShooterCharacter::PrepareWeaponAnimClass(USkeletalMeshComponent* TargetMesh, TSubclassOf<UAnimInstance> WeaponAnimClass, TSubclassOf<UAnimInstance> CurrentLinkedLayers)
+{
+	if (!WeaponAnimClass || WeaponAnimLayerSupport.Contains(WeaponAnimClass))
+	{
+		return;
+	}
+
+	UAnimInstance* AnimInstance = TargetMesh->GetAnimInstance();
+	bool bSupported = false;
+
+	if (bLinkWeaponAnimLayers && AnimInstance && AnimInstance->GetClass() != WeaponAnimClass.Get())
+	{
+		// link the layers once to see if the running graph hosts them
+		TargetMesh->LinkAnimClassLayers(WeaponAnimClass);
+
+		bSupported = AnimInstance->GetLinkedAnimLayerInstanceByClass(WeaponAnimClass) != nullptr;
+
+		// put back whatever the equipped weapon had linked
+		if (CurrentLinkedLayers)
+		{
+			TargetMesh->LinkAnimClassLayers(CurrentLinkedLayers);
+
+		} else {
+
+			TargetMesh->UnlinkAnimClassLayers(WeaponAnimClass);
+		}
+	}
+
+	WeaponAnimLayerSupport.Add(WeaponAnimClass, bSupported);
+}
+
+void AShooterCharacter::ApplyWeaponAnimClass(USkeletalMeshComponent* TargetMesh, TSubclassOf<UAnimInstance> WeaponAnimClass, TSubclassOf<UAnimInstance>& InOutLinkedLayers)
+{
+	if (!WeaponAnimClass || InOutLinkedLayers == WeaponAnimClass)
+	{
+		return;
+	}
+
+	// weapons are normally prepared when they're attached, but make sure in case this one skipped it
+	PrepareWeaponAnimClass(TargetMesh, WeaponAnimClass, InOutLinkedLayers);
+
+	UAnimInstance* AnimInstance = TargetMesh->GetAnimInstance();
+
+	// swap the weapon's layers into the running graph, which keeps the rest of it alive
+	if (bLinkWeaponAnimLayers && WeaponAnimLayerSupport.FindRef(WeaponAnimClass) && AnimInstance && AnimInstance->GetClass() != WeaponAnimClass.Get())
+	{
+		TargetMesh->LinkAnimClassLayers(WeaponAnimClass);
+		InOutLinkedLayers = WeaponAnimClass;
+		return;
+	}
+
+	// the anim blueprint doesn't host the weapon's layers, so the weapon class has to replace it
+	InOutLinkedLayers = nullptr;
+
+	if (!AnimInstance || AnimInstance->GetClass() != WeaponAnimClass.Get())
+	{
+		TargetMesh->SetAnimInstanceClass(WeaponAnimClass);
+	}
 }
 
 void AShooterCharacter::OnWeaponDeactivated(AShooterWeapon* Weapon)
@@ -386,12 +645,15 @@ void AShooterCharacter::OnRep_CurrentHP()
 	UpdateHealthHUD();
 }
 
-void AShooterCharacter::OnRep_CurrentWeapon()
+void AShooterCharacter::OnRep_ServerWeapon()
 {
-	if (CurrentWeapon)
+	// our own switches are predicted, so only fall back to the server's weapon once it has answered all of them
+	if (IsLocallyControlled() && AckedWeaponSwitch != WeaponSwitchSequence)
 	{
-		OnWeaponActivated(CurrentWeapon);
+		return;
 	}
+
+	EquipWeapon(ServerWeapon);
 }
 
 void AShooterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -399,5 +661,8 @@ void AShooterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Ou
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(AShooterCharacter, CurrentHP);
-	DOREPLIFETIME(AShooterCharacter, CurrentWeapon);
+	DOREPLIFETIME(AShooterCharacter, ServerWeapon);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, OwnedWeapons, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, AckedWeaponSwitch, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, AckedFireInput, COND_OwnerOnly);
 }
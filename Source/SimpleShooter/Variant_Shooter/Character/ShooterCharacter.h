@@ -5,12 +5,15 @@
 #include "CoreMinimal.h"
 #include "SimpleShooterCharacter.h"
 #include "ShooterWeaponHolder.h"
+#include "ShooterFireInput.h"
 #include "ShooterCharacter.generated.h"
 
 class AShooterWeapon;
 class UInputAction;
 class UInputComponent;
 class UPawnNoiseEmitterComponent;
+class UAnimInstance;
+class USkeletalMeshComponent;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FBulletCountUpdatedDelegate, int32, MagazineSize, int32, Bullets);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDamagedDelegate, float, LifePercent);
@@ -66,13 +69,58 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Team")
 	uint8 TeamByte = 0;
 
-	/** List of weapons picked up by the character */
-	TArray<AShooterWeapon*> OwnedWeapons;
+	/** List of weapons picked up by the character. Replicated to the owner so it can switch between them locally */
+	UPROPERTY(Replicated)
+	TArray<TObjectPtr<AShooterWeapon>> OwnedWeapons;
 
-	/** Weapon currently equipped and ready to shoot with */
-	UPROPERTY(ReplicatedUsing = OnRep_CurrentWeapon)
+	/** Weapon currently equipped and ready to shoot with. Predicted on the owning client */
+	UPROPERTY(Transient)
 	TObjectPtr<AShooterWeapon> CurrentWeapon;
 
+	/** Weapon the server has equipped */
+	UPROPERTY(ReplicatedUsing = OnRep_ServerWeapon)
+	TObjectPtr<AShooterWeapon> ServerWeapon;
+
+	/** Sequence of the last weapon switch the owning client predicted */
+	uint8 WeaponSwitchSequence = 0;
+
+	/** Sequence of the last weapon switch request the server answered, accepted or not */
+	UPROPERTY(ReplicatedUsing = OnRep_ServerWeapon)
+	uint8 AckedWeaponSwitch = 0;
+
+	/** If true, weapon anim classes are linked as anim layers into the running graph when the mesh's anim blueprint hosts them, instead of replacing it */
+	UPROPERTY(EditAnywhere, Category="Animation")
+	bool bLinkWeaponAnimLayers = true;
+
+	/** Trigger transitions sent to the server that it hasn't acknowledged yet, oldest first */
+	TArray<FShooterFireInputEvent> PendingFireInputs;
+
+	/** Sequence to give the next trigger transition */
+	uint16 NextFireInputSequence = 1;
+
+	/** Sequence of the last trigger transition the server applied */
+	UPROPERTY(ReplicatedUsing = OnRep_AckedFireInput)
+	uint16 AckedFireInput = 0;
+
+	/** Time between redundant resends of unacknowledged trigger transitions */
+	UPROPERTY(EditAnywhere, Category="Input", meta = (ClampMin = 0.01, ClampMax = 1, Units = "s"))
+	float FireInputResendInterval = 0.05f;
+
+	/** Timer to resend unacknowledged trigger transitions */
+	FTimerHandle FireInputResendTimer;
+
+	/** Aim the client pressed the trigger with, used by the server for the first shot of the press */
+	TOptional<FRotator> PendingFireAim;
+
+	/** Weapon anim class currently linked as layers into the first person mesh */
+	TSubclassOf<UAnimInstance> LinkedFirstPersonLayers;
+
+	/** Weapon anim class currently linked as layers into the third person mesh */
+	TSubclassOf<UAnimInstance> LinkedThirdPersonLayers;
+
+	/** Anim classes of the weapons picked up so far, and whether their mesh's anim blueprint hosts them as layers */
+	TMap<TSubclassOf<UAnimInstance>, bool> WeaponAnimLayerSupport;
+
 	UPROPERTY(EditAnywhere, Category ="Destruction", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
 	float RespawnTime = 5.0f;
 
@@ -125,17 +173,34 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Input")
 	void DoSwitchWeapon();
 
-	/** Handles start firing input */
-	UFUNCTION(Server, Reliable, BlueprintCallable, Category = "Input")
-	void ServerDoStartFiring();
+	/** Records a trigger transition with the current weapon state and aim, to be sent to the server */
+	void QueueFireInput(bool bPressed);
 
-	/** Handles stop firing input */
-	UFUNCTION(Server, Reliable, BlueprintCallable, Category = "Input")
-	void ServerDoStopFiring();
+	/** Sends every unacknowledged trigger transition, and keeps resending them until the server acknowledges */
+	void SendFireInputs();
 
-	/** Handles switch weapon input */
-	UFUNCTION(Server, Reliable, BlueprintCallable, Category = "Input")
-	void ServerDoSwitchWeapon();
+	/** Receives the client's latest trigger transitions. Unreliable, since every packet repeats the ones before it */
+	UFUNCTION(Server, Unreliable)
+	void ServerFireInput(const FShooterFireInputPacket& Packet);
+
+	/** Applies a trigger transition on the server, lining the weapon up with the client's predictions */
+	void ApplyFireInput(const FShooterFireInputEvent& Event);
+
+	/** Handles a weapon switch the client already predicted. Rejected switches are still acknowledged so the client falls back to our weapon */
+	UFUNCTION(Server, Reliable)
+	void ServerDoSwitchWeapon(AShooterWeapon* Weapon, uint8 Sequence);
+
+	/** Returns the owned weapon after the current one, wrapping around */
+	AShooterWeapon* GetNextWeapon() const;
+
+	/** Deactivates the current weapon and activates the given one */
+	void EquipWeapon(AShooterWeapon* NewWeapon);
+
+	/** Links a picked up weapon's anim class into a mesh once to find out if it can be used as layers, then restores the current layers */
+	void PrepareWeaponAnimClass(USkeletalMeshComponent* TargetMesh, TSubclassOf<UAnimInstance> WeaponAnimClass, TSubclassOf<UAnimInstance> CurrentLinkedLayers);
+
+	/** Swaps a weapon anim class into a mesh, as linked layers if possible or as the whole anim instance otherwise */
+	void ApplyWeaponAnimClass(USkeletalMeshComponent* TargetMesh, TSubclassOf<UAnimInstance> WeaponAnimClass, TSubclassOf<UAnimInstance>& InOutLinkedLayers);
 
 public:
 
@@ -202,6 +267,11 @@ protected:
 	UFUNCTION()
 	void OnRep_CurrentHP();
 
+	/** Drops the trigger transitions the server has applied */
+	UFUNCTION()
+	void OnRep_AckedFireInput();
+
+	/** Equips the server's weapon, unless the owning client still has predicted switches the server hasn't answered */
 	UFUNCTION()
-	void OnRep_CurrentWeapon();
+	void OnRep_ServerWeapon();
 };
@@ -0,0 +1,53 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterFireInput.h"
+
+bool FShooterFireInputEvent::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	Ar << Sequence;
+
+	uint8 bPressedBit = bPressed ? 1 : 0;
+	Ar.SerializeBits(&bPressedBit, 1);
+	bPressed = bPressedBit != 0;
+
+	Ar << ClientTime;
+	Ar << WeaponId;
+	Ar << FirstShotId;
+	Ar << FireSequence;
+
+	// bullet counts are small, so pack them
+	uint32 PackedBullets = Bullets;
+	Ar.SerializeIntPacked(PackedBullets);
+	Bullets = static_cast<uint16>(PackedBullets);
+
+	// aim to 16 bits per axis, the same as control rotation
+	Aim.SerializeCompressedShort(Ar);
+
+	return true;
+}
+
+bool FShooterFireInputPacket::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	uint32 NumEvents = FMath::Min(Events.Num(), ShooterFireInputRedundancy);
+	Ar.SerializeInt(NumEvents, ShooterFireInputRedundancy + 1);
+
+	if (Ar.IsLoading())
+	{
+		Events.SetNum(NumEvents);
+	}
+
+	for (uint32 i = 0; i < NumEvents; ++i)
+	{
+		bool bEventSuccess = true;
+		Events[i].NetSerialize(Ar, Map, bEventSuccess);
+
+		bOutSuccess &= bEventSuccess;
+	}
+
+	return true;
+}
@@ -0,0 +1,92 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "ShooterFireInput.generated.h"
+
+/** Max number of unacknowledged trigger transitions repeated in every fire input packet, oldest first */
+static constexpr int32 ShooterFireInputRedundancy = 4;
+
+/** Max number of unacknowledged trigger transitions a client holds on to. Past this the oldest is given up and the server sees a gap */
+static constexpr int32 ShooterFireInputMaxPending = 32;
+
+/**
+ *  A single trigger press or release, as seen by the owning client
+ */
+USTRUCT()
+struct FShooterFireInputEvent
+{
+	GENERATED_BODY()
+
+	/** Per-character input counter, so the server applies every transition once and in order */
+	UPROPERTY()
+	uint16 Sequence = 0;
+
+	/** True for a press, false for a release */
+	UPROPERTY()
+	bool bPressed = false;
+
+	/** Server world time of the transition, as estimated by the client. Only trusted within the round trip time the server measures */
+	UPROPERTY()
+	float ClientTime = 0.0f;
+
+	/** Weapon ID of the weapon the client had equipped */
+	UPROPERTY()
+	uint8 WeaponId = MAX_uint8;
+
+	/** ID the client gave the first shot fired by this transition */
+	UPROPERTY()
+	uint16 FirstShotId = 0;
+
+	/** Client shot counter at the transition, for ammo reconciliation */
+	UPROPERTY()
+	uint16 FireSequence = 0;
+
+	/** Client predicted bullet count at the transition */
+	UPROPERTY()
+	uint16 Bullets = 0;
+
+	/** Aim rotation at the transition */
+	UPROPERTY()
+	FRotator Aim = FRotator::ZeroRotator;
+
+	/** Quantizes the event to under twenty bytes */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterFireInputEvent> : public TStructOpsTypeTraitsBase2<FShooterFireInputEvent>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/**
+ *  The oldest trigger transitions of a client the server hasn't acknowledged, sent unreliably and redundantly
+ *  A lost packet costs nothing, since its transitions are repeated until the server acknowledges them
+ */
+USTRUCT()
+struct FShooterFireInputPacket
+{
+	GENERATED_BODY()
+
+	/** Transitions the server hasn't acknowledged yet, oldest first */
+	UPROPERTY()
+	TArray<FShooterFireInputEvent> Events;
+
+	/** Writes the event count in a few bits followed by each event */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterFireInputPacket> : public TStructOpsTypeTraitsBase2<FShooterFireInputPacket>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
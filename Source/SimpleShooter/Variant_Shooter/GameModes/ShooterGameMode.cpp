@@ -9,6 +9,14 @@
 #include "PlayerStates/ShooterPlayerState.h"
 #include "AIController.h"
 #include "GameStates/ShooterGameState.h"
+#include "ShooterProjectilePool.h"
+
+void AShooterGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	RandomSeed = UGameplayStatics::GetIntOption(Options, TEXT("Seed"), RandomSeed);
+}
 
 void AShooterGameMode::BeginPlay()
 {
@@ -22,9 +30,24 @@ void AShooterGameMode::BeginPlay()
 
 	UGameplayStatics::GetAllActorsWithTag(GetWorld(), "AISpawnPoint", AISpawnPoints);
 
+	// pre-warm the projectile pools so the first firefight doesn't pay for spawning
+	if (UShooterProjectilePool* Pool = GetWorld()->GetSubsystem<UShooterProjectilePool>())
+	{
+		for (const TPair<TSubclassOf<AShooterProjectile>, int32>& Prewarm : ProjectilePoolPrewarm)
+		{
+			Pool->Prewarm(Prewarm.Key, Prewarm.Value);
+		}
+	}
+
 	SpawnAI(4);
 }
 
+int32 AShooterGameMode::MakeRandomSeed()
+{
+	// mix the index in so consecutive seeds don't give correlated streams
+	return static_cast<int32>(HashCombine(static_cast<uint32>(RandomSeed), MurmurFinalize32(NumRandomSeeds++)));
+}
+
 void AShooterGameMode::IncrementTeamScore(uint8 TeamByte)
 {
 	// retrieve the team score if any
@@ -9,6 +9,7 @@
 class AShooterPlayerState;
 class AShooterNPC;
 class AShooterAIController;
+class AShooterProjectile;
 
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGameOver);
@@ -46,6 +47,14 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Shooter|Respawn", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
 	float RespawnTime = 5.0f;
 
+	/** Number of projectiles of each class to spawn into the projectile pool when the map loads */
+	UPROPERTY(EditAnywhere, Category = "Shooter|Projectiles")
+	TMap<TSubclassOf<AShooterProjectile>, int32> ProjectilePoolPrewarm;
+
+	/** Base seed for every weapon's spread and aim error. Set it per level through the world settings game mode, or with ?Seed= on the map URL */
+	UPROPERTY(EditAnywhere, Category = "Shooter|Random")
+	int32 RandomSeed = 0;
+
 	TArray<AActor*> PlayerStarts;
 
 	TArray<AActor*> AISpawnPoints;
@@ -59,8 +68,14 @@ protected:
 private:
 	int32 PendingAISpawnCount = 0;
 
+	/** Number of seeds handed out so far */
+	int32 NumRandomSeeds = 0;
+
 protected:
 
+	/** Reads the random seed override from the map URL */
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
 	/** Gameplay initialization */
 	virtual void BeginPlay() override;
 
@@ -82,6 +97,9 @@ protected:
 
 public:
 
+	/** Returns the next seed derived from the base seed. Actors asking in the same order get the same seeds every run */
+	int32 MakeRandomSeed();
+
 	/** Increases the score for the given team */
 	void IncrementTeamScore(uint8 TeamByte);	
 
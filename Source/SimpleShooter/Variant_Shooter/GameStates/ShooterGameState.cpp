@@ -4,6 +4,7 @@
 #include "Variant_Shooter/GameStates/ShooterGameState.h"
 #include "PlayerStates/ShooterPlayerState.h"
 #include "ShooterGameMode.h"
+#include "ShooterProjectile.h"
 #include <Net/UnrealNetwork.h>
 
 
@@ -44,6 +45,7 @@ void AShooterGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Ou
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(AShooterGameState, bIsGameOver);
+	DOREPLIFETIME(AShooterGameState, ProjectileClassRegistry);
 }
 
 void AShooterGameState::UpdatePlayerScores()
@@ -72,3 +74,21 @@ void AShooterGameState::UpdatePlayerScores()
 		PlayerScores[i].Rank = i + 1;
 	}
 }
+
+int32 AShooterGameState::GetProjectileClassIndex(TSubclassOf<AShooterProjectile> ProjectileClass)
+{
+	int32 Index = ProjectileClassRegistry.Find(ProjectileClass);
+
+	// only the server can add classes. Indices must fit in a byte
+	if (Index == INDEX_NONE && HasAuthority() && ProjectileClass && ProjectileClassRegistry.Num() < MAX_uint8)
+	{
+		Index = ProjectileClassRegistry.Add(ProjectileClass);
+	}
+
+	return Index;
+}
+
+TSubclassOf<AShooterProjectile> AShooterGameState::GetProjectileClassByIndex(int32 Index) const
+{
+	return ProjectileClassRegistry.IsValidIndex(Index) ? ProjectileClassRegistry[Index] : nullptr;
+}
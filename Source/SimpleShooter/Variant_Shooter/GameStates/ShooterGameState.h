@@ -7,6 +7,7 @@
 #include "ShooterGameState.generated.h"
 
 class AShooterPlayerState;
+class AShooterProjectile;
 //class FOnGameOver;
 
 USTRUCT(BlueprintType)
@@ -55,5 +56,19 @@ public:
 	void UpdatePlayerScores();
 
 	FOnGameOver OnGameOver;
+
+protected:
+
+	/** Projectile classes that can be referenced by index in compact spawn records */
+	UPROPERTY(Replicated)
+	TArray<TSubclassOf<AShooterProjectile>> ProjectileClassRegistry;
+
+public:
+
+	/** Returns the registry index of the given projectile class, registering it on the server if needed. Returns INDEX_NONE if it isn't registered */
+	int32 GetProjectileClassIndex(TSubclassOf<AShooterProjectile> ProjectileClass);
+
+	/** Returns the projectile class registered at the given index, or nullptr if it hasn't replicated yet */
+	TSubclassOf<AShooterProjectile> GetProjectileClassByIndex(int32 Index) const;
 	
 };
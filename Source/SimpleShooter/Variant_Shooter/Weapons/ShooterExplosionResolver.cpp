@@ -0,0 +1,250 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterExplosionResolver.h"
+#include "ShooterProjectile.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/World.h"
+
+bool UShooterExplosionResolver::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterExplosionResolver::Deinitialize()
+{
+	PendingExplosions.Empty();
+	Victims.Empty();
+	VictimIndices.Empty();
+	AppliedPairs.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterExplosionResolver::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterExplosionResolver, STATGROUP_Tickables);
+}
+
+void UShooterExplosionResolver::QueueExplosion(const FShooterProjectileImpactParams& Params, const FVector& ExplosionCenter)
+{
+	FShooterQueuedExplosion& Explosion = PendingExplosions.AddDefaulted_GetRef();
+	Explosion.Center = ExplosionCenter;
+
+	// copy the tuning from the projectile that exploded, so per-instance changes are kept
+	Explosion.Radius = Params.Settings->GetExplosionRadius();
+	Explosion.PhysicsForce = Params.Settings->GetPhysicsForce() * Params.ImpulseScale;
+	Explosion.DamageType = Params.Settings->GetHitDamageType();
+	Explosion.bCanDamageOwner = Params.Settings->CanDamageOwner();
+	Explosion.Instigator = Params.Instigator;
+	Explosion.DamageCauser = Params.DamageCauser;
+	Explosion.Damage = Params.Damage;
+	Explosion.bHasAuthority = Params.bHasAuthority;
+}
+
+void UShooterExplosionResolver::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (PendingExplosions.Num() == 0)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterExplosionResolver::Tick);
+
+	GatherVictims();
+	ApplyVictims();
+
+	// keep the memory around for the next frame
+	PendingExplosions.Reset();
+	Victims.Reset();
+	VictimIndices.Reset();
+	AppliedPairs.Reset();
+}
+
+void UShooterExplosionResolver::GatherVictims()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterExplosionResolver::GatherVictims);
+
+	// size the grid so an explosion never spans more than two cells per axis
+	float MaxRadius = 0.0f;
+
+	for (const FShooterQueuedExplosion& Explosion : PendingExplosions)
+	{
+		MaxRadius = FMath::Max(MaxRadius, Explosion.Radius);
+	}
+
+	const double CellSize = FMath::Max(2.0 * MaxRadius, 1.0);
+
+	// bucket the explosions by cell
+	TMap<FIntVector, TArray<int32, TInlineAllocator<4>>> Cells;
+
+	for (int32 i = 0; i < PendingExplosions.Num(); ++i)
+	{
+		const FVector& Center = PendingExplosions[i].Center;
+		const FIntVector Cell(FMath::FloorToInt32(Center.X / CellSize), FMath::FloorToInt32(Center.Y / CellSize), FMath::FloorToInt32(Center.Z / CellSize));
+
+		Cells.FindOrAdd(Cell).Add(i);
+	}
+
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	ObjectParams.AddObjectTypesToQuery(ECC_PhysicsBody);
+
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterExplosionResolver), false);
+
+	TArray<FOverlapResult> Overlaps;
+
+	for (const TPair<FIntVector, TArray<int32, TInlineAllocator<4>>>& Cell : Cells)
+	{
+		// one overlap covering every explosion in the cell
+		FBox CellBounds(ForceInit);
+
+		for (const int32 ExplosionIndex : Cell.Value)
+		{
+			const FShooterQueuedExplosion& Explosion = PendingExplosions[ExplosionIndex];
+			CellBounds += FBox::BuildAABB(Explosion.Center, FVector(Explosion.Radius));
+		}
+
+		Overlaps.Reset();
+		GetWorld()->OverlapMultiByObjectType(Overlaps, CellBounds.GetCenter(), FQuat::Identity, ObjectParams, FCollisionShape::MakeBox(CellBounds.GetExtent()), QueryParams);
+
+		// narrow phase: test each component's collision shape against each explosion sphere in the cell, same as a per-explosion sphere overlap
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			AActor* Actor = Overlap.GetActor();
+			UPrimitiveComponent* Component = Overlap.GetComponent();
+
+			if (!Actor || !Component)
+			{
+				continue;
+			}
+
+			const FBox ComponentBounds = Component->Bounds.GetBox();
+
+			for (const int32 ExplosionIndex : Cell.Value)
+			{
+				const FShooterQueuedExplosion& Explosion = PendingExplosions[ExplosionIndex];
+
+				// cheap reject on the bounds first
+				if (ComponentBounds.ComputeSquaredDistanceToPoint(Explosion.Center) > FMath::Square(Explosion.Radius))
+				{
+					continue;
+				}
+
+				if (Component->OverlapComponent(Explosion.Center, FQuat::Identity, FCollisionShape::MakeSphere(Explosion.Radius)))
+				{
+					AccumulateHit(ExplosionIndex, Actor, Component);
+				}
+			}
+		}
+	}
+}
+
+void UShooterExplosionResolver::AccumulateHit(int32 ExplosionIndex, AActor* Actor, UPrimitiveComponent* Component)
+{
+	const FShooterQueuedExplosion& Explosion = PendingExplosions[ExplosionIndex];
+
+	APawn* Instigator = Explosion.Instigator.Get();
+	AActor* DamageCauser = Explosion.DamageCauser.Get();
+
+	// the projectile never hits itself, and only hits its shooter if allowed to
+	if ((Actor == DamageCauser && DamageCauser != Instigator) || (Actor == Instigator && !Explosion.bCanDamageOwner))
+	{
+		return;
+	}
+
+	// characters are only affected with authority
+	const bool bIsCharacter = Actor->IsA<ACharacter>();
+
+	if (bIsCharacter && !Explosion.bHasAuthority)
+	{
+		return;
+	}
+
+	// overlaps return an actor once per component, so make sure each explosion only counts once per actor
+	bool bAlreadyApplied = false;
+	AppliedPairs.Add(TPair<int32, const AActor*>(ExplosionIndex, Actor), &bAlreadyApplied);
+
+	if (bAlreadyApplied)
+	{
+		return;
+	}
+
+	// find or add the victim entry
+	int32* VictimIndex = VictimIndices.Find(Actor);
+
+	if (!VictimIndex)
+	{
+		const int32 NewIndex = Victims.AddDefaulted();
+		Victims[NewIndex].Actor = Actor;
+		Victims[NewIndex].ImpulseComponent = Component;
+
+		VictimIndex = &VictimIndices.Add(Actor, NewIndex);
+	}
+
+	FShooterExplosionVictim& Victim = Victims[*VictimIndex];
+
+	// push away from the explosion
+	Victim.Impulse += (Actor->GetActorLocation() - Explosion.Center).GetSafeNormal() * Explosion.PhysicsForce;
+	Victim.ImpulseLocationSum += Explosion.Center;
+	++Victim.ImpulseCount;
+
+	// add to the damage owed to the instigator's entry
+	if (bIsCharacter)
+	{
+		FShooterExplosionDamage* Damage = Victim.Damages.FindByPredicate([Instigator](const FShooterExplosionDamage& Entry)
+		{
+			return Entry.Instigator.Get() == Instigator;
+		});
+
+		if (!Damage)
+		{
+			Damage = &Victim.Damages.AddDefaulted_GetRef();
+			Damage->Instigator = Instigator;
+			Damage->DamageCauser = DamageCauser;
+			Damage->DamageType = Explosion.DamageType;
+		}
+
+		Damage->Damage += Explosion.Damage;
+	}
+}
+
+void UShooterExplosionResolver::ApplyVictims()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterExplosionResolver::ApplyVictims);
+
+	for (const FShooterExplosionVictim& Victim : Victims)
+	{
+		AActor* Actor = Victim.Actor.Get();
+
+		if (!Actor)
+		{
+			continue;
+		}
+
+		// one damage event per instigator
+		for (const FShooterExplosionDamage& Damage : Victim.Damages)
+		{
+			APawn* Instigator = Damage.Instigator.Get();
+			AController* InstigatorController = Instigator ? Instigator->GetController() : nullptr;
+
+			UGameplayStatics::ApplyDamage(Actor, Damage.Damage, InstigatorController, Damage.DamageCauser.Get(), Damage.DamageType);
+		}
+
+		// one impulse from the average explosion location
+		UPrimitiveComponent* ImpulseComponent = Victim.ImpulseComponent.Get();
+
+		if (ImpulseComponent && ImpulseComponent->IsSimulatingPhysics() && Victim.ImpulseCount > 0)
+		{
+			ImpulseComponent->AddImpulseAtLocation(Victim.Impulse, Victim.ImpulseLocationSum / Victim.ImpulseCount);
+		}
+	}
+}
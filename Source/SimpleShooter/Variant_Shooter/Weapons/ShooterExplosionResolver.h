@@ -0,0 +1,141 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterExplosionResolver.generated.h"
+
+class APawn;
+class UDamageType;
+class UPrimitiveComponent;
+struct FShooterProjectileImpactParams;
+
+/**
+ *  An explosion waiting to be resolved at the end of the frame
+ */
+struct FShooterQueuedExplosion
+{
+	/** Explosion center */
+	FVector Center = FVector::ZeroVector;
+
+	/** Explosion radius of the projectile that exploded */
+	float Radius = 0.0f;
+
+	/** Impulse applied to physics bodies in range, already scaled by the impact's impulse scale */
+	float PhysicsForce = 0.0f;
+
+	/** Damage type to apply */
+	TSubclassOf<UDamageType> DamageType;
+
+	/** If true, the explosion can damage the pawn that shot it */
+	bool bCanDamageOwner = false;
+
+	/** Pawn that shot the projectile */
+	TWeakObjectPtr<APawn> Instigator;
+
+	/** Actor reported as the cause of the damage */
+	TWeakObjectPtr<AActor> DamageCauser;
+
+	/** Damage to apply to characters in range */
+	float Damage = 0.0f;
+
+	/** If true, damage is applied. Without authority only physics impulses are applied */
+	bool bHasAuthority = false;
+};
+
+/**
+ *  Damage owed to a victim by one instigator this frame
+ */
+struct FShooterExplosionDamage
+{
+	/** Pawn that caused the explosions */
+	TWeakObjectPtr<APawn> Instigator;
+
+	/** Actor reported as the cause of the damage */
+	TWeakObjectPtr<AActor> DamageCauser;
+
+	/** Damage type of the first explosion */
+	TSubclassOf<UDamageType> DamageType;
+
+	/** Sum of the damage of every explosion */
+	float Damage = 0.0f;
+};
+
+/**
+ *  Everything this frame's explosions do to a single actor
+ */
+struct FShooterExplosionVictim
+{
+	/** Affected actor */
+	TWeakObjectPtr<AActor> Actor;
+
+	/** Component the impulse is applied to */
+	TWeakObjectPtr<UPrimitiveComponent> ImpulseComponent;
+
+	/** Sum of the impulses of every explosion */
+	FVector Impulse = FVector::ZeroVector;
+
+	/** Sum of the explosion centers, averaged to get the impulse location */
+	FVector ImpulseLocationSum = FVector::ZeroVector;
+
+	/** Number of explosions pushing the actor */
+	int32 ImpulseCount = 0;
+
+	/** Damage owed, one entry per instigator */
+	TArray<FShooterExplosionDamage, TInlineAllocator<2>> Damages;
+};
+
+/**
+ *  Resolves all explosions of a frame in one batch
+ *  Explosions are queued as they happen, bucketed into a uniform grid and overlapped once per occupied cell.
+ *  Each overlapped component is then tested against the sphere of every explosion in the cell using its real collision shape.
+ *  Each affected actor then receives a single aggregated damage event per instigator and a single impulse
+ */
+UCLASS()
+class SIMPLESHOOTER_API UShooterExplosionResolver : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Explosions queued this frame */
+	TArray<FShooterQueuedExplosion> PendingExplosions;
+
+	/** Scratch: affected actors of the current batch */
+	TArray<FShooterExplosionVictim> Victims;
+
+	/** Scratch: maps each affected actor to its entry in the victim list */
+	TMap<const AActor*, int32> VictimIndices;
+
+	/** Scratch: explosion and actor pairs that were already applied, so multi-component actors are only hit once per explosion */
+	TSet<TPair<int32, const AActor*>> AppliedPairs;
+
+protected:
+
+	/** Only create the resolver for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Resolves the explosions queued this frame */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns the stat ID for tick profiling */
+	virtual TStatId GetStatId() const override;
+
+	/** Queues an explosion to be resolved at the end of the frame */
+	void QueueExplosion(const FShooterProjectileImpactParams& Params, const FVector& ExplosionCenter);
+
+protected:
+
+	/** Gathers the victims of the queued explosions with one overlap per occupied grid cell */
+	void GatherVictims();
+
+	/** Adds the effect of one explosion on one actor to its victim entry */
+	void AccumulateHit(int32 ExplosionIndex, AActor* Actor, UPrimitiveComponent* Component);
+
+	/** Applies the aggregated damage and impulses */
+	void ApplyVictims();
+};
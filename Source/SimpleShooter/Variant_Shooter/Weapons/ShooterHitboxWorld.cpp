@@ -0,0 +1,372 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterHitboxWorld.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+#include "Engine/HitResult.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Algo/Count.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/VectorRegister.h"
+#include "SimpleShooter.h"
+
+/** Number of capsules tested per SIMD register */
+static constexpr int32 HitboxLaneCount = 4;
+
+/** Location of padding capsules. Far enough that any hit on them is out of range, close enough that squaring it doesn't overflow */
+static constexpr float HitboxPaddingLocation = 1.0e18f;
+
+static FAutoConsoleCommandWithWorldAndArgs CVarShooterHitboxBenchmark(
+	TEXT("Shooter.Hitbox.Benchmark"),
+	TEXT("Times the hitbox kernel against LineTraceSingleByChannel on rays between the characters in the world. Optional argument: number of rays"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumRays = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10000;
+
+		// gather the character capsules
+		FShooterHitboxWorld HitboxWorld;
+		TArray<const ACharacter*> Characters;
+
+		for (TActorIterator<ACharacter> It(World); It; ++It)
+		{
+			const UCapsuleComponent* Capsule = It->GetCapsuleComponent();
+			HitboxWorld.AddCapsule(Capsule->GetComponentLocation(), Capsule->GetScaledCapsuleHalfHeight(), Capsule->GetScaledCapsuleRadius(), *It);
+			Characters.Add(*It);
+		}
+
+		if (Characters.Num() < 2)
+		{
+			UE_LOG(LogSimpleShooter, Warning, TEXT("Hitbox benchmark needs at least two characters in the world"));
+			return;
+		}
+
+		// shoot from each character's eyes at a jittered point on another character
+		FRandomStream Stream(1234);
+		TArray<FShooterHitboxRay> Rays;
+		Rays.SetNum(NumRays);
+
+		for (FShooterHitboxRay& Ray : Rays)
+		{
+			const ACharacter* Shooter = Characters[Stream.RandHelper(Characters.Num())];
+			const ACharacter* Target = Characters[Stream.RandHelper(Characters.Num())];
+
+			FVector EyeLocation;
+			FRotator EyeRotation;
+			Shooter->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+
+			const FVector Aim = Target->GetActorLocation() + Stream.VRand() * 100.0f;
+
+			Ray.Start = EyeLocation;
+			Ray.End = EyeLocation + (Aim - EyeLocation).GetSafeNormal() * 10000.0f;
+			Ray.IgnoredActor = Shooter;
+		}
+
+		TArray<FShooterHitboxHit> Hits;
+		Hits.SetNum(NumRays);
+
+		// vectorized kernel
+		double StartTime = FPlatformTime::Seconds();
+		HitboxWorld.RaycastMany(Rays, Hits);
+		const double KernelTime = FPlatformTime::Seconds() - StartTime;
+
+		const int32 KernelHits = Algo::CountIf(Hits, [](const FShooterHitboxHit& Hit) { return Hit.IsValidHit(); });
+
+		// scalar reference
+		int32 ScalarHits = 0;
+		StartTime = FPlatformTime::Seconds();
+
+		for (int32 i = 0; i < NumRays; ++i)
+		{
+			ScalarHits += HitboxWorld.RaycastScalar(Rays[i], Hits[i]) ? 1 : 0;
+		}
+
+		const double ScalarTime = FPlatformTime::Seconds() - StartTime;
+
+		// physics scene query
+		int32 TraceHits = 0;
+		StartTime = FPlatformTime::Seconds();
+
+		for (const FShooterHitboxRay& Ray : Rays)
+		{
+			FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterHitboxBenchmark), false, Ray.IgnoredActor);
+
+			FHitResult Hit;
+			TraceHits += World->LineTraceSingleByChannel(Hit, Ray.Start, Ray.End, ECC_Pawn, QueryParams) ? 1 : 0;
+		}
+
+		const double TraceTime = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogSimpleShooter, Log, TEXT("Hitbox benchmark: %d rays against %d capsules"), NumRays, HitboxWorld.Num());
+		UE_LOG(LogSimpleShooter, Log, TEXT("  kernel:      %8.3f ms (%6.3f us/ray), %d hits"), KernelTime * 1000.0, KernelTime * 1.0e6 / NumRays, KernelHits);
+		UE_LOG(LogSimpleShooter, Log, TEXT("  scalar:      %8.3f ms (%6.3f us/ray), %d hits"), ScalarTime * 1000.0, ScalarTime * 1.0e6 / NumRays, ScalarHits);
+		UE_LOG(LogSimpleShooter, Log, TEXT("  line trace:  %8.3f ms (%6.3f us/ray), %d hits, includes world geometry"), TraceTime * 1000.0, TraceTime * 1.0e6 / NumRays, TraceHits);
+	})
+);
+
+/** Returns the distance along a unit ray to where it enters an upright capsule, or MAX_flt if it misses */
+static float IntersectCapsuleScalar(const FVector3f& Start, const FVector3f& Direction, float Length, float CenterX, float CenterY, float BottomZ, float TopZ, float Radius)
+{
+	const float RadiusSquared = Radius * Radius;
+	const float MX = Start.X - CenterX;
+	const float MY = Start.Y - CenterY;
+
+	float Best = MAX_flt;
+
+	// side of the capsule: an infinite vertical cylinder, clipped to the axis
+	const float A = Direction.X * Direction.X + Direction.Y * Direction.Y;
+
+	if (A > UE_SMALL_NUMBER)
+	{
+		const float B = MX * Direction.X + MY * Direction.Y;
+		const float C = MX * MX + MY * MY - RadiusSquared;
+		const float Discriminant = B * B - A * C;
+
+		if (Discriminant >= 0.0f)
+		{
+			const float Root = FMath::Sqrt(Discriminant);
+			const float Exit = (-B + Root) / A;
+			const float Entry = FMath::Max((-B - Root) / A, 0.0f);
+			const float EntryZ = Start.Z + Entry * Direction.Z;
+
+			if (Exit >= 0.0f && Entry <= Length && EntryZ >= BottomZ && EntryZ <= TopZ)
+			{
+				Best = Entry;
+			}
+		}
+	}
+
+	// hemispheres
+	for (const float SphereZ : { BottomZ, TopZ })
+	{
+		const float MZ = Start.Z - SphereZ;
+		const float B = MX * Direction.X + MY * Direction.Y + MZ * Direction.Z;
+		const float C = MX * MX + MY * MY + MZ * MZ - RadiusSquared;
+		const float Discriminant = B * B - C;
+
+		if (Discriminant >= 0.0f)
+		{
+			const float Root = FMath::Sqrt(Discriminant);
+			const float Entry = FMath::Max(-B - Root, 0.0f);
+
+			if (-B + Root >= 0.0f && Entry <= Length)
+			{
+				Best = FMath::Min(Best, Entry);
+			}
+		}
+	}
+
+	return Best;
+}
+
+void FShooterHitboxWorld::Reset()
+{
+	CenterX.Reset();
+	CenterY.Reset();
+	BottomZ.Reset();
+	TopZ.Reset();
+	Radii.Reset();
+	Owners.Reset();
+
+	NumCapsules = 0;
+}
+
+int32 FShooterHitboxWorld::AddCapsule(const FVector& Center, float HalfHeight, float Radius, const AActor* Owner)
+{
+	const int32 Index = NumCapsules++;
+
+	// grow all arrays a whole register at a time, filling the new lanes with unreachable capsules
+	if (Index % HitboxLaneCount == 0)
+	{
+		for (TArray<float>* Lane : { &CenterX, &CenterY, &BottomZ, &TopZ })
+		{
+			Lane->Add(HitboxPaddingLocation);
+			Lane->Add(HitboxPaddingLocation);
+			Lane->Add(HitboxPaddingLocation);
+			Lane->Add(HitboxPaddingLocation);
+		}
+
+		Radii.AddZeroed(HitboxLaneCount);
+	}
+
+	const float AxisHalfLength = FMath::Max(HalfHeight - Radius, 0.0f);
+
+	CenterX[Index] = Center.X;
+	CenterY[Index] = Center.Y;
+	BottomZ[Index] = Center.Z - AxisHalfLength;
+	TopZ[Index] = Center.Z + AxisHalfLength;
+	Radii[Index] = Radius;
+
+	Owners.Add(Owner);
+
+	return Index;
+}
+
+FVector FShooterHitboxWorld::GetClosestAxisPoint(int32 CapsuleIndex, const FVector& Location) const
+{
+	return FVector(CenterX[CapsuleIndex], CenterY[CapsuleIndex], FMath::Clamp<double>(Location.Z, BottomZ[CapsuleIndex], TopZ[CapsuleIndex]));
+}
+
+bool FShooterHitboxWorld::Raycast(const FShooterHitboxRay& Ray, FShooterHitboxHit& OutHit) const
+{
+	OutHit = FShooterHitboxHit();
+
+	const FVector3f Start(Ray.Start);
+	const FVector3f Delta(Ray.End - Ray.Start);
+	const float Length = Delta.Size();
+
+	if (Length <= UE_KINDA_SMALL_NUMBER || NumCapsules == 0)
+	{
+		return false;
+	}
+
+	const FVector3f Direction = Delta / Length;
+
+	// broadcast the ray to every lane
+	const VectorRegister4Float StartX = VectorSetFloat1(Start.X);
+	const VectorRegister4Float StartY = VectorSetFloat1(Start.Y);
+	const VectorRegister4Float StartZ = VectorSetFloat1(Start.Z);
+	const VectorRegister4Float DirX = VectorSetFloat1(Direction.X);
+	const VectorRegister4Float DirY = VectorSetFloat1(Direction.Y);
+	const VectorRegister4Float DirZ = VectorSetFloat1(Direction.Z);
+	const VectorRegister4Float RayLength = VectorSetFloat1(Length);
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float Miss = VectorSetFloat1(MAX_flt);
+
+	// a vertical ray never enters the side of an upright capsule
+	const float HorizontalLengthSquared = Direction.X * Direction.X + Direction.Y * Direction.Y;
+	const bool bTestSides = HorizontalLengthSquared > UE_SMALL_NUMBER;
+
+	const VectorRegister4Float A = VectorSetFloat1(bTestSides ? HorizontalLengthSquared : 1.0f);
+
+	alignas(16) float LaneDistances[HitboxLaneCount];
+
+	const int32 NumLanes = CenterX.Num();
+
+	for (int32 Base = 0; Base < NumLanes; Base += HitboxLaneCount)
+	{
+		const VectorRegister4Float CX = VectorLoad(&CenterX[Base]);
+		const VectorRegister4Float CY = VectorLoad(&CenterY[Base]);
+		const VectorRegister4Float Bottom = VectorLoad(&BottomZ[Base]);
+		const VectorRegister4Float Top = VectorLoad(&TopZ[Base]);
+		const VectorRegister4Float Radius = VectorLoad(&Radii[Base]);
+
+		const VectorRegister4Float RadiusSquared = VectorMultiply(Radius, Radius);
+		const VectorRegister4Float MX = VectorSubtract(StartX, CX);
+		const VectorRegister4Float MY = VectorSubtract(StartY, CY);
+
+		// horizontal terms shared by the side and both hemispheres
+		const VectorRegister4Float HorizontalB = VectorMultiplyAdd(MY, DirY, VectorMultiply(MX, DirX));
+		const VectorRegister4Float HorizontalC = VectorMultiplyAdd(MY, MY, VectorMultiply(MX, MX));
+
+		VectorRegister4Float Best = Miss;
+
+		// side of the capsule
+		if (bTestSides)
+		{
+			const VectorRegister4Float C = VectorSubtract(HorizontalC, RadiusSquared);
+			const VectorRegister4Float Discriminant = VectorSubtract(VectorMultiply(HorizontalB, HorizontalB), VectorMultiply(A, C));
+			const VectorRegister4Float Root = VectorSqrt(VectorMax(Discriminant, Zero));
+			const VectorRegister4Float Exit = VectorDivide(VectorSubtract(Root, HorizontalB), A);
+			const VectorRegister4Float Entry = VectorMax(VectorDivide(VectorNegate(VectorAdd(HorizontalB, Root)), A), Zero);
+			const VectorRegister4Float EntryZ = VectorMultiplyAdd(Entry, DirZ, StartZ);
+
+			VectorRegister4Float Valid = VectorCompareGE(Discriminant, Zero);
+			Valid = VectorBitwiseAnd(Valid, VectorCompareGE(Exit, Zero));
+			Valid = VectorBitwiseAnd(Valid, VectorCompareLE(Entry, RayLength));
+			Valid = VectorBitwiseAnd(Valid, VectorCompareGE(EntryZ, Bottom));
+			Valid = VectorBitwiseAnd(Valid, VectorCompareLE(EntryZ, Top));
+
+			Best = VectorSelect(Valid, Entry, Best);
+		}
+
+		// hemispheres
+		for (const VectorRegister4Float& SphereZ : { Bottom, Top })
+		{
+			const VectorRegister4Float MZ = VectorSubtract(StartZ, SphereZ);
+			const VectorRegister4Float B = VectorMultiplyAdd(MZ, DirZ, HorizontalB);
+			const VectorRegister4Float C = VectorSubtract(VectorMultiplyAdd(MZ, MZ, HorizontalC), RadiusSquared);
+			const VectorRegister4Float Discriminant = VectorSubtract(VectorMultiply(B, B), C);
+			const VectorRegister4Float Root = VectorSqrt(VectorMax(Discriminant, Zero));
+			const VectorRegister4Float Exit = VectorSubtract(Root, B);
+			const VectorRegister4Float Entry = VectorMax(VectorNegate(VectorAdd(B, Root)), Zero);
+
+			VectorRegister4Float Valid = VectorCompareGE(Discriminant, Zero);
+			Valid = VectorBitwiseAnd(Valid, VectorCompareGE(Exit, Zero));
+			Valid = VectorBitwiseAnd(Valid, VectorCompareLE(Entry, RayLength));
+
+			Best = VectorSelect(Valid, VectorMin(Entry, Best), Best);
+		}
+
+		// most registers miss entirely, so only drop to scalar code when a lane hit something
+		if (VectorMaskBits(VectorCompareLT(Best, Miss)) == 0)
+		{
+			continue;
+		}
+
+		VectorStoreAligned(Best, LaneDistances);
+
+		for (int32 Lane = 0; Lane < HitboxLaneCount; ++Lane)
+		{
+			const int32 Index = Base + Lane;
+
+			if (Index < NumCapsules && LaneDistances[Lane] < MAX_flt && Owners[Index] != Ray.IgnoredActor
+				&& (!OutHit.IsValidHit() || LaneDistances[Lane] < OutHit.Distance))
+			{
+				OutHit.CapsuleIndex = Index;
+				OutHit.Distance = LaneDistances[Lane];
+			}
+		}
+	}
+
+	return OutHit.IsValidHit();
+}
+
+void FShooterHitboxWorld::RaycastMany(TConstArrayView<FShooterHitboxRay> Rays, TArrayView<FShooterHitboxHit> OutHits) const
+{
+	check(Rays.Num() == OutHits.Num());
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FShooterHitboxWorld::RaycastMany);
+
+	// the capsule arrays are small enough to stay in cache across every ray
+	for (int32 i = 0; i < Rays.Num(); ++i)
+	{
+		Raycast(Rays[i], OutHits[i]);
+	}
+}
+
+bool FShooterHitboxWorld::RaycastScalar(const FShooterHitboxRay& Ray, FShooterHitboxHit& OutHit) const
+{
+	OutHit = FShooterHitboxHit();
+
+	const FVector3f Start(Ray.Start);
+	const FVector3f Delta(Ray.End - Ray.Start);
+	const float Length = Delta.Size();
+
+	if (Length <= UE_KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const FVector3f Direction = Delta / Length;
+
+	for (int32 Index = 0; Index < NumCapsules; ++Index)
+	{
+		if (Owners[Index] == Ray.IgnoredActor)
+		{
+			continue;
+		}
+
+		const float Distance = IntersectCapsuleScalar(Start, Direction, Length, CenterX[Index], CenterY[Index], BottomZ[Index], TopZ[Index], Radii[Index]);
+
+		if (Distance < MAX_flt && (!OutHit.IsValidHit() || Distance < OutHit.Distance))
+		{
+			OutHit.CapsuleIndex = Index;
+			OutHit.Distance = Distance;
+		}
+	}
+
+	return OutHit.IsValidHit();
+}
@@ -0,0 +1,92 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+/**
+ *  A ray to test against a hitbox world
+ */
+struct FShooterHitboxRay
+{
+	/** Ray origin */
+	FVector Start = FVector::ZeroVector;
+
+	/** Ray end */
+	FVector End = FVector::ZeroVector;
+
+	/** Actor whose capsules the ray passes through, usually the shooter */
+	const AActor* IgnoredActor = nullptr;
+};
+
+/**
+ *  Closest capsule hit by a ray
+ */
+struct FShooterHitboxHit
+{
+	/** Index of the capsule that was hit, or INDEX_NONE */
+	int32 CapsuleIndex = INDEX_NONE;
+
+	/** Distance from the ray origin to the entry point */
+	float Distance = 0.0f;
+
+	/** Returns true if the ray hit a capsule */
+	bool IsValidHit() const { return CapsuleIndex != INDEX_NONE; };
+};
+
+/**
+ *  Flat set of upright capsules that rays can be tested against without a physics scene query
+ *  Capsules are stored as structure-of-arrays, padded to the SIMD register width,
+ *  so one ray is tested against four capsules at a time through the engine's vector intrinsics
+ */
+class SIMPLESHOOTER_API FShooterHitboxWorld
+{
+	/** Capsule axis X */
+	TArray<float> CenterX;
+
+	/** Capsule axis Y */
+	TArray<float> CenterY;
+
+	/** Center of the bottom hemisphere */
+	TArray<float> BottomZ;
+
+	/** Center of the top hemisphere */
+	TArray<float> TopZ;
+
+	/** Capsule radius */
+	TArray<float> Radii;
+
+	/** Actor each capsule belongs to */
+	TArray<const AActor*> Owners;
+
+	/** Number of real capsules, not counting the padding */
+	int32 NumCapsules = 0;
+
+public:
+
+	/** Removes every capsule but keeps the memory */
+	void Reset();
+
+	/** Adds an upright capsule. Half height includes the hemispheres, like UCapsuleComponent. Returns the capsule index */
+	int32 AddCapsule(const FVector& Center, float HalfHeight, float Radius, const AActor* Owner);
+
+	/** Returns the number of capsules */
+	int32 Num() const { return NumCapsules; };
+
+	/** Returns the actor the given capsule belongs to */
+	const AActor* GetOwner(int32 CapsuleIndex) const { return Owners[CapsuleIndex]; };
+
+	/** Returns the point on the axis of the given capsule closest to a location, used to build impact normals */
+	FVector GetClosestAxisPoint(int32 CapsuleIndex, const FVector& Location) const;
+
+	/** Finds the closest capsule hit by the ray using the vectorized kernel */
+	bool Raycast(const FShooterHitboxRay& Ray, FShooterHitboxHit& OutHit) const;
+
+	/** Finds the closest capsule hit by each ray. OutHits must have one entry per ray */
+	void RaycastMany(TConstArrayView<FShooterHitboxRay> Rays, TArrayView<FShooterHitboxHit> OutHits) const;
+
+	/** Reference scalar implementation of Raycast, one capsule at a time */
+	bool RaycastScalar(const FShooterHitboxRay& Ray, FShooterHitboxHit& OutHit) const;
+};
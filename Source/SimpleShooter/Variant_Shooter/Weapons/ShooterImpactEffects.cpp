@@ -0,0 +1,262 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterImpactEffects.h"
+#include "ShooterProjectile.h"
+#include "NiagaraFunctionLibrary.h"
+#include "Components/DecalComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Engine/HitResult.h"
+#include "Engine/World.h"
+#include "SimpleShooter.h"
+
+bool UShooterImpactEffects::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// dedicated servers never see an impact
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UShooterImpactEffects::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterImpactEffects::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (ResponseTable.IsNull())
+	{
+		return;
+	}
+
+	const UDataTable* LoadedResponseTable = ResponseTable.LoadSynchronous();
+
+	if (!LoadedResponseTable)
+	{
+		UE_LOG(LogSimpleShooter, Warning, TEXT("ShooterImpactEffects: couldn't load %s, impacts will use the projectile's Blueprint event"), *ResponseTable.ToString());
+		return;
+	}
+
+	if (LoadedResponseTable->GetRowStruct() != FShooterImpactResponseRow::StaticStruct())
+	{
+		UE_LOG(LogSimpleShooter, Warning, TEXT("ShooterImpactEffects: %s doesn't use FShooterImpactResponseRow and will be ignored"), *LoadedResponseTable->GetName());
+		return;
+	}
+
+	// copy the rows so queued impacts never point into a table that could be reimported under us
+	for (const TPair<FName, uint8*>& Row : LoadedResponseTable->GetRowMap())
+	{
+		Responses.Add(*reinterpret_cast<const FShooterImpactResponseRow*>(Row.Value));
+	}
+}
+
+void UShooterImpactEffects::Deinitialize()
+{
+	if (DecalOwner)
+	{
+		DecalOwner->Destroy();
+		DecalOwner = nullptr;
+	}
+
+	Decals.Empty();
+	DecalExpireTimes.Empty();
+	PendingImpacts.Empty();
+	ResponseCache.Empty();
+	Responses.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterImpactEffects::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterImpactEffects, STATGROUP_Tickables);
+}
+
+bool UShooterImpactEffects::QueueImpact(const UClass* ProjectileClass, const FHitResult& Hit)
+{
+	if (Responses.Num() == 0 || GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return false;
+	}
+
+	const int32 ResponseIndex = FindResponse(ProjectileClass, Hit.PhysMaterial.Get());
+
+	if (ResponseIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FShooterQueuedImpact& Impact = PendingImpacts.AddDefaulted_GetRef();
+	Impact.ResponseIndex = ResponseIndex;
+	Impact.Location = Hit.ImpactPoint;
+	Impact.Normal = Hit.ImpactNormal;
+
+	return true;
+}
+
+void UShooterImpactEffects::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterImpactEffects::Tick);
+
+	ExpireDecals();
+
+	if (PendingImpacts.Num() == 0)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+
+	TArray<const FShooterQueuedImpact*, TInlineAllocator<32>> Dispatched;
+	int32 NumDropped = 0;
+
+	for (const FShooterQueuedImpact& Impact : PendingImpacts)
+	{
+		// pellets and bursts landing on the same spot only need one effect
+		const bool bMerged = Dispatched.ContainsByPredicate([&Impact, this](const FShooterQueuedImpact* Other)
+		{
+			return Other->ResponseIndex == Impact.ResponseIndex && FVector::DistSquared(Other->Location, Impact.Location) < FMath::Square(ImpactMergeDistance);
+		});
+
+		if (bMerged)
+		{
+			continue;
+		}
+
+		if (Dispatched.Num() >= MaxImpactsPerFrame)
+		{
+			++NumDropped;
+			continue;
+		}
+
+		Dispatched.Add(&Impact);
+
+		const FShooterImpactResponseRow& Response = Responses[Impact.ResponseIndex];
+
+		if (Response.Effect)
+		{
+			UNiagaraFunctionLibrary::SpawnSystemAtLocation(World, Response.Effect, Impact.Location, Impact.Normal.Rotation(), FVector::OneVector, true, true, ENCPoolMethod::AutoRelease);
+		}
+
+		if (Response.Sound)
+		{
+			UGameplayStatics::PlaySoundAtLocation(World, Response.Sound, Impact.Location);
+		}
+
+		if (Response.DecalMaterial)
+		{
+			PlaceDecal(Response, Impact.Location, Impact.Normal);
+		}
+	}
+
+	if (NumDropped > 0)
+	{
+		UE_LOG(LogSimpleShooter, Log, TEXT("ShooterImpactEffects: dropped %d impacts over the limit of %d per frame"), NumDropped, MaxImpactsPerFrame);
+	}
+
+	// keep the memory around for the next frame
+	PendingImpacts.Reset();
+}
+
+int32 UShooterImpactEffects::FindResponse(const UClass* ProjectileClass, const UPhysicalMaterial* PhysicalMaterial)
+{
+	const TPair<const UClass*, const UPhysicalMaterial*> Key(ProjectileClass, PhysicalMaterial);
+
+	if (const int32* Cached = ResponseCache.Find(Key))
+	{
+		return *Cached;
+	}
+
+	int32 Response = INDEX_NONE;
+
+	// prefer the hit surface over any surface, and within each the most derived class over any class
+	const UPhysicalMaterial* Surfaces[] = { PhysicalMaterial, nullptr };
+
+	for (const UPhysicalMaterial* Surface : Surfaces)
+	{
+		for (const UClass* Class = ProjectileClass; Class && Response == INDEX_NONE; Class = Class->GetSuperClass())
+		{
+			Response = FindExactResponse(Class, Surface);
+		}
+
+		if (Response == INDEX_NONE)
+		{
+			Response = FindExactResponse(nullptr, Surface);
+		}
+
+		if (Response != INDEX_NONE)
+		{
+			break;
+		}
+	}
+
+	ResponseCache.Add(Key, Response);
+
+	return Response;
+}
+
+int32 UShooterImpactEffects::FindExactResponse(const UClass* ProjectileClass, const UPhysicalMaterial* PhysicalMaterial) const
+{
+	return Responses.IndexOfByPredicate([ProjectileClass, PhysicalMaterial](const FShooterImpactResponseRow& Response)
+	{
+		return Response.ProjectileClass.Get() == ProjectileClass && Response.PhysicalMaterial == PhysicalMaterial;
+	});
+}
+
+void UShooterImpactEffects::PlaceDecal(const FShooterImpactResponseRow& Response, const FVector& Location, const FVector& Normal)
+{
+	if (MaxDecals <= 0)
+	{
+		return;
+	}
+
+	// create the actor that owns the decal pool on first use
+	if (!DecalOwner)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+
+		DecalOwner = GetWorld()->SpawnActor<AActor>(SpawnParams);
+	}
+
+	int32 DecalIndex = NextDecal;
+
+	// grow the pool until it's full, then recycle the oldest decal
+	if (Decals.Num() < MaxDecals)
+	{
+		UDecalComponent* NewDecal = NewObject<UDecalComponent>(DecalOwner);
+		NewDecal->RegisterComponent();
+
+		DecalIndex = Decals.Add(NewDecal);
+		DecalExpireTimes.Add(0.0f);
+	}
+
+	NextDecal = (DecalIndex + 1) % MaxDecals;
+
+	UDecalComponent* Decal = Decals[DecalIndex];
+
+	// project into the surface
+	Decal->DecalSize = Response.DecalSize;
+	Decal->SetDecalMaterial(Response.DecalMaterial);
+	Decal->SetWorldLocationAndRotation(Location, (-Normal).Rotation());
+	Decal->SetVisibility(true);
+
+	DecalExpireTimes[DecalIndex] = GetWorld()->GetTimeSeconds() + Response.DecalLifetime;
+}
+
+void UShooterImpactEffects::ExpireDecals()
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	for (int32 i = 0; i < Decals.Num(); ++i)
+	{
+		if (Decals[i] && Decals[i]->IsVisible() && DecalExpireTimes[i] <= Now)
+		{
+			Decals[i]->SetVisibility(false);
+		}
+	}
+}
@@ -0,0 +1,161 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/DataTable.h"
+#include "ShooterImpactEffects.generated.h"
+
+class AShooterProjectile;
+class UNiagaraSystem;
+class USoundBase;
+class UMaterialInterface;
+class UPhysicalMaterial;
+class UDecalComponent;
+
+/**
+ *  Effects to play when a projectile class hits a physical material
+ */
+USTRUCT(BlueprintType)
+struct FShooterImpactResponseRow : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	/** Projectile class this response applies to, including its subclasses. None matches any projectile */
+	UPROPERTY(EditAnywhere)
+	TSubclassOf<AShooterProjectile> ProjectileClass;
+
+	/** Surface this response applies to. None matches any surface */
+	UPROPERTY(EditAnywhere)
+	TObjectPtr<UPhysicalMaterial> PhysicalMaterial;
+
+	/** Particle effect to spawn at the impact, from the Niagara component pool */
+	UPROPERTY(EditAnywhere)
+	TObjectPtr<UNiagaraSystem> Effect;
+
+	/** Sound to play at the impact */
+	UPROPERTY(EditAnywhere)
+	TObjectPtr<USoundBase> Sound;
+
+	/** Decal to project onto the surface */
+	UPROPERTY(EditAnywhere)
+	TObjectPtr<UMaterialInterface> DecalMaterial;
+
+	/** Size of the decal */
+	UPROPERTY(EditAnywhere)
+	FVector DecalSize = FVector(8.0f, 16.0f, 16.0f);
+
+	/** Time the decal stays up, unless it's recycled earlier */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = 0, ClampMax = 600, Units = "s"))
+	float DecalLifetime = 10.0f;
+};
+
+/**
+ *  Impact waiting for the end of frame dispatch
+ */
+struct FShooterQueuedImpact
+{
+	/** Index of the response to play */
+	int32 ResponseIndex = INDEX_NONE;
+
+	/** Impact location */
+	FVector Location = FVector::ZeroVector;
+
+	/** Surface normal at the impact */
+	FVector Normal = FVector::UpVector;
+};
+
+/**
+ *  Plays projectile impact effects natively from an impact response table
+ *  Responses are looked up by projectile class and physical material. Impacts are queued as they happen
+ *  and dispatched once per frame, with nearby duplicates merged, effects taken from the Niagara pool
+ *  and decals recycled from a fixed pool. Never created on dedicated servers
+ */
+UCLASS(Config=Game)
+class SIMPLESHOOTER_API UShooterImpactEffects : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Data table of FShooterImpactResponseRow. Without one, impacts fall back to the projectile's Blueprint event */
+	UPROPERTY(Config)
+	TSoftObjectPtr<UDataTable> ResponseTable;
+
+	/** Max number of decals kept in the world. The oldest one is recycled past this */
+	UPROPERTY(Config)
+	int32 MaxDecals = 64;
+
+	/** Max number of impacts dispatched per frame. Extra impacts are dropped and logged */
+	UPROPERTY(Config)
+	int32 MaxImpactsPerFrame = 32;
+
+	/** Impacts with the same response closer than this in one frame only play once */
+	UPROPERTY(Config)
+	float ImpactMergeDistance = 20.0f;
+
+	/** Rows copied out of the response table, so nothing points into the table's row map */
+	UPROPERTY(Transient)
+	TArray<FShooterImpactResponseRow> Responses;
+
+	/** Response indices by projectile class and physical material, including resolved fallbacks. INDEX_NONE means no response */
+	TMap<TPair<const UClass*, const UPhysicalMaterial*>, int32> ResponseCache;
+
+	/** Impacts queued this frame */
+	TArray<FShooterQueuedImpact> PendingImpacts;
+
+	/** Actor owning the pooled decals */
+	UPROPERTY(Transient)
+	TObjectPtr<AActor> DecalOwner;
+
+	/** Pooled decals */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UDecalComponent>> Decals;
+
+	/** World time each pooled decal should be hidden at */
+	TArray<float> DecalExpireTimes;
+
+	/** Index of the next decal to recycle */
+	int32 NextDecal = 0;
+
+protected:
+
+	/** Only create the subsystem where impacts can be seen */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/** Only create the subsystem for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Loads the response table */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Dispatches the impacts queued this frame */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns the stat ID for tick profiling */
+	virtual TStatId GetStatId() const override;
+
+	/** Queues the effects of a projectile impact. Returns false if the table has no response for it */
+	bool QueueImpact(const UClass* ProjectileClass, const FHitResult& Hit);
+
+	/** Returns true if a response table was loaded */
+	bool HasResponses() const { return Responses.Num() > 0; };
+
+protected:
+
+	/** Returns the index of the response for a projectile class and surface, falling back to parent classes and then to any surface */
+	int32 FindResponse(const UClass* ProjectileClass, const UPhysicalMaterial* PhysicalMaterial);
+
+	/** Returns the index of the response matching a class and surface exactly */
+	int32 FindExactResponse(const UClass* ProjectileClass, const UPhysicalMaterial* PhysicalMaterial) const;
+
+	/** Places a decal from the pool */
+	void PlaceDecal(const FShooterImpactResponseRow& Response, const FVector& Location, const FVector& Normal);
+
+	/** Hides decals that outlived their response's lifetime */
+	void ExpireDecals();
+};
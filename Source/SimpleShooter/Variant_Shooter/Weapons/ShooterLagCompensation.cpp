@@ -0,0 +1,354 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterLagCompensation.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/HitResult.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarShooterLagCompensationMaxRewind(
+	TEXT("Shooter.LagCompensation.MaxRewind"),
+	0.4f,
+	TEXT("Max time, in seconds, that shots from remote players are rewound. 0 disables lag compensation"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarShooterLagCompensationMaxProjectileFastForward(
+	TEXT("Shooter.LagCompensation.MaxProjectileFastForward"),
+	0.15f,
+	TEXT("Max time, in seconds, that projectiles fired by remote players are fast-forwarded on spawn to make up for their one-way latency. 0 disables it"),
+	ECVF_Default);
+
+void FShooterHitboxHistory::Record(const FShooterHitboxFrame& Frame)
+{
+	Head = (Head + 1) % ShooterHitboxHistorySize;
+	Frames[Head] = Frame;
+	Count = FMath::Min(Count + 1, ShooterHitboxHistorySize);
+}
+
+bool FShooterHitboxHistory::Sample(float Time, FShooterHitboxFrame& OutFrame) const
+{
+	if (Count == 0)
+	{
+		return false;
+	}
+
+	// the requested time is at or past our newest frame, so use it rather than extrapolating
+	if (Time >= Frames[Head].Time)
+	{
+		OutFrame = Frames[Head];
+		return true;
+	}
+
+	// walk back from the newest frame until we find the one right before the requested time
+	const FShooterHitboxFrame* Newer = &Frames[Head];
+
+	for (int32 i = 1; i < Count; ++i)
+	{
+		const FShooterHitboxFrame& Older = Frames[(Head - i + ShooterHitboxHistorySize) % ShooterHitboxHistorySize];
+
+		if (Older.Time <= Time)
+		{
+			// a capsule without collision can't be hit, so don't blend it with one that has
+			if (Older.HalfHeight <= 0.0f || Newer->HalfHeight <= 0.0f)
+			{
+				OutFrame = (Time - Older.Time < Newer->Time - Time) ? Older : *Newer;
+				return true;
+			}
+
+			const float Alpha = FMath::Clamp(FMath::GetRangePct(Older.Time, Newer->Time, Time), 0.0f, 1.0f);
+
+			OutFrame.Location = FMath::Lerp(Older.Location, Newer->Location, Alpha);
+			OutFrame.HalfHeight = FMath::Lerp(Older.HalfHeight, Newer->HalfHeight, Alpha);
+			OutFrame.Time = Time;
+			return true;
+		}
+
+		Newer = &Older;
+	}
+
+	// the requested time is older than our history, so use the oldest frame we have
+	OutFrame = *Newer;
+	return true;
+}
+
+bool UShooterLagCompensation::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterLagCompensation::Deinitialize()
+{
+	Histories.Empty();
+	HistoryIndices.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterLagCompensation::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterLagCompensation, STATGROUP_Tickables);
+}
+
+void UShooterLagCompensation::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterLagCompensation::Tick);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// tickable subsystems run after actors, so this captures the final positions for the frame
+	for (FShooterHitboxHistory& History : Histories)
+	{
+		if (const ACharacter* Character = History.Character.Get())
+		{
+			History.Record(MakeFrame(Character->GetCapsuleComponent(), Now));
+		}
+	}
+}
+
+void UShooterLagCompensation::RegisterCharacter(ACharacter* Character)
+{
+	if (!Character || IsRegistered(Character))
+	{
+		return;
+	}
+
+	const int32 Index = Histories.AddDefaulted();
+
+	FShooterHitboxHistory& History = Histories[Index];
+	History.Character = Character;
+	History.Radius = Character->GetCapsuleComponent()->GetScaledCapsuleRadius();
+
+	// seed the history so the character can be rewound right away
+	History.Record(MakeFrame(Character->GetCapsuleComponent(), GetWorld()->GetTimeSeconds()));
+
+	HistoryIndices.Add(Character, Index);
+}
+
+void UShooterLagCompensation::UnregisterCharacter(ACharacter* Character)
+{
+	int32 Index = INDEX_NONE;
+
+	if (!HistoryIndices.RemoveAndCopyValue(Character, Index))
+	{
+		return;
+	}
+
+	Histories.RemoveAtSwap(Index, EAllowShrinking::No);
+
+	// fix up the index of the history we swapped into the hole
+	if (Histories.IsValidIndex(Index))
+	{
+		if (const ACharacter* Moved = Histories[Index].Character.Get())
+		{
+			HistoryIndices.Add(Moved, Index);
+		}
+	}
+}
+
+void UShooterLagCompensation::GetRegisteredCharacters(TArray<AActor*>& OutCharacters) const
+{
+	for (const FShooterHitboxHistory& History : Histories)
+	{
+		if (ACharacter* Character = History.Character.Get())
+		{
+			OutCharacters.Add(Character);
+		}
+	}
+}
+
+float UShooterLagCompensation::GetShooterViewTime(const APawn* Shooter) const
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	if (!ShouldCompensate(Shooter))
+	{
+		return Now;
+	}
+
+	// the shooter fired at targets it saw a round trip ago: half to get the state to it, and the shot's own trip back
+	const float RoundTripTime = Shooter->GetPlayerState()->ExactPing * 0.0005f + GetShotOneWayTime(Shooter);
+
+	return Now - FMath::Min(RoundTripTime, CVarShooterLagCompensationMaxRewind.GetValueOnGameThread());
+}
+
+void UShooterLagCompensation::ReportInputDelay(const ACharacter* Character, float Delay)
+{
+	const int32* Index = HistoryIndices.Find(Character);
+
+	if (!Index)
+	{
+		return;
+	}
+
+	// the client's estimate of our clock can be off by a lot, but the trip here can never take longer than the full
+	// round trip we measured ourselves, nor longer than we could ever rewind
+	float MaxDelay = CVarShooterLagCompensationMaxRewind.GetValueOnGameThread();
+
+	if (const APlayerState* PlayerState = Character->GetPlayerState())
+	{
+		MaxDelay = FMath::Min(MaxDelay, PlayerState->ExactPing * 0.001f);
+	}
+
+	Delay = FMath::Clamp(Delay, 0.0f, MaxDelay);
+
+	float& InputDelay = Histories[*Index].InputDelay;
+	InputDelay = InputDelay < 0.0f ? Delay : FMath::Lerp(InputDelay, Delay, 0.2f);
+}
+
+float UShooterLagCompensation::GetShotOneWayTime(const APawn* Shooter) const
+{
+	// prefer the delay we measured from the shooter's fire input
+	if (const int32* Index = HistoryIndices.Find(Cast<ACharacter>(Shooter)))
+	{
+		if (Histories[*Index].InputDelay >= 0.0f)
+		{
+			return Histories[*Index].InputDelay;
+		}
+	}
+
+	return Shooter->GetPlayerState()->ExactPing * 0.0005f;
+}
+
+float UShooterLagCompensation::GetProjectileFastForwardTime(const APawn* Shooter) const
+{
+	if (!ShouldCompensate(Shooter))
+	{
+		return 0.0f;
+	}
+
+	// the shot left the shooter's muzzle one way trip before its fire request got here
+	const float OneWayTime = GetShotOneWayTime(Shooter);
+
+	return FMath::Clamp(OneWayTime, 0.0f, CVarShooterLagCompensationMaxProjectileFastForward.GetValueOnGameThread());
+}
+
+bool UShooterLagCompensation::ShouldCompensate(const APawn* Shooter) const
+{
+	return Shooter && Shooter->GetPlayerState() && Shooter->IsPlayerControlled() && !Shooter->IsLocallyControlled()
+		&& CVarShooterLagCompensationMaxRewind.GetValueOnGameThread() > 0.0f;
+}
+
+bool UShooterLagCompensation::GetCapsuleAtTime(const ACharacter* Character, float Time, FShooterHitboxFrame& OutFrame, float& OutRadius) const
+{
+	const int32* Index = HistoryIndices.Find(Character);
+
+	if (!Index)
+	{
+		return false;
+	}
+
+	OutRadius = Histories[*Index].Radius;
+	return Histories[*Index].Sample(Time, OutFrame);
+}
+
+bool UShooterLagCompensation::TraceRewound(const FVector& Start, const FVector& End, float Time, const AActor* IgnoredActor, FHitResult& OutHit) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterLagCompensation::TraceRewound);
+
+	RewindHitboxes(Time, IgnoredActor);
+
+	FShooterHitboxRay Ray;
+	Ray.Start = Start;
+	Ray.End = End;
+	Ray.IgnoredActor = IgnoredActor;
+
+	FShooterHitboxHit HitboxHit;
+
+	if (!RewoundHitboxes.Raycast(Ray, HitboxHit))
+	{
+		return false;
+	}
+
+	OutHit = MakeRewoundHit(Start, End, HitboxHit);
+	return true;
+}
+
+void UShooterLagCompensation::TraceRewoundMany(const FVector& Start, TConstArrayView<FVector> Ends, float Time, const AActor* IgnoredActor, TArrayView<FHitResult> InOutHits) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterLagCompensation::TraceRewoundMany);
+
+	check(Ends.Num() == InOutHits.Num());
+
+	RewindHitboxes(Time, IgnoredActor);
+
+	if (RewoundHitboxes.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<FShooterHitboxRay, TInlineAllocator<32>> Rays;
+	Rays.SetNum(Ends.Num());
+
+	for (int32 i = 0; i < Ends.Num(); ++i)
+	{
+		Rays[i].Start = Start;
+		Rays[i].End = Ends[i];
+		Rays[i].IgnoredActor = IgnoredActor;
+	}
+
+	TArray<FShooterHitboxHit, TInlineAllocator<32>> HitboxHits;
+	HitboxHits.SetNum(Ends.Num());
+
+	RewoundHitboxes.RaycastMany(Rays, HitboxHits);
+
+	for (int32 i = 0; i < Ends.Num(); ++i)
+	{
+		if (HitboxHits[i].IsValidHit())
+		{
+			InOutHits[i] = MakeRewoundHit(Start, Ends[i], HitboxHits[i]);
+		}
+	}
+}
+
+void UShooterLagCompensation::RewindHitboxes(float Time, const AActor* IgnoredActor) const
+{
+	// gather every capsule as it was at the requested time
+	RewoundHitboxes.Reset();
+
+	for (const FShooterHitboxHistory& History : Histories)
+	{
+		const ACharacter* Character = History.Character.Get();
+
+		FShooterHitboxFrame Frame;
+
+		if (Character && Character != IgnoredActor && History.Sample(Time, Frame) && Frame.HalfHeight > 0.0f)
+		{
+			RewoundHitboxes.AddCapsule(Frame.Location, Frame.HalfHeight, History.Radius, Character);
+		}
+	}
+}
+
+FHitResult UShooterLagCompensation::MakeRewoundHit(const FVector& Start, const FVector& End, const FShooterHitboxHit& HitboxHit) const
+{
+	ACharacter* HitCharacter = const_cast<ACharacter*>(CastChecked<ACharacter>(RewoundHitboxes.GetOwner(HitboxHit.CapsuleIndex)));
+
+	const FVector ImpactPoint = Start + (End - Start).GetSafeNormal() * HitboxHit.Distance;
+	const FVector AxisPoint = RewoundHitboxes.GetClosestAxisPoint(HitboxHit.CapsuleIndex, ImpactPoint);
+
+	FHitResult Hit(HitCharacter, HitCharacter->GetCapsuleComponent(), ImpactPoint, (ImpactPoint - AxisPoint).GetSafeNormal());
+	Hit.TraceStart = Start;
+	Hit.TraceEnd = End;
+	Hit.Distance = HitboxHit.Distance;
+
+	// this constructor leaves the hit non-blocking, and the capsule has no faces
+	Hit.bBlockingHit = true;
+	Hit.FaceIndex = INDEX_NONE;
+	Hit.Time = HitboxHit.Distance / FVector::Dist(Start, End);
+
+	return Hit;
+}
+
+FShooterHitboxFrame UShooterLagCompensation::MakeFrame(const UCapsuleComponent* Capsule, float Time)
+{
+	FShooterHitboxFrame Frame;
+	Frame.Location = Capsule->GetComponentLocation();
+	Frame.Time = Time;
+	Frame.HalfHeight = Capsule->IsQueryCollisionEnabled() ? Capsule->GetScaledCapsuleHalfHeight() : 0.0f;
+
+	return Frame;
+}
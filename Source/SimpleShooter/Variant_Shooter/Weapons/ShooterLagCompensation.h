@@ -0,0 +1,151 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterHitboxWorld.h"
+#include "ShooterLagCompensation.generated.h"
+
+class ACharacter;
+class APawn;
+class UCapsuleComponent;
+struct FHitResult;
+
+/** Number of frames kept per character. About a second of history at a 60Hz server tick */
+static constexpr int32 ShooterHitboxHistorySize = 64;
+
+/**
+ *  Capsule state of a character at one server frame
+ *  Character capsules stay upright, so the location and half height fully describe them
+ */
+struct FShooterHitboxFrame
+{
+	/** Capsule center */
+	FVector Location = FVector::ZeroVector;
+
+	/** Server world time the frame was recorded at */
+	float Time = 0.0f;
+
+	/** Capsule half height. Zero if the capsule had collision disabled */
+	float HalfHeight = 0.0f;
+};
+
+/**
+ *  Fixed-size ring buffer of capsule frames for one character
+ */
+struct FShooterHitboxHistory
+{
+	/** Character this history belongs to */
+	TWeakObjectPtr<ACharacter> Character;
+
+	/** Capsule radius. Characters don't change it at runtime */
+	float Radius = 0.0f;
+
+	/** Smoothed time the character's fire input takes to reach the server. Negative until one has been measured */
+	float InputDelay = -1.0f;
+
+	/** Index of the most recent frame */
+	int32 Head = INDEX_NONE;
+
+	/** Number of valid frames */
+	int32 Count = 0;
+
+	/** Recorded frames, oldest overwritten first */
+	TStaticArray<FShooterHitboxFrame, ShooterHitboxHistorySize> Frames;
+
+	/** Adds a frame, overwriting the oldest one once the buffer is full */
+	void Record(const FShooterHitboxFrame& Frame);
+
+	/** Interpolates the capsule state at the given time. Returns false if there's no history to sample */
+	bool Sample(float Time, FShooterHitboxFrame& OutFrame) const;
+};
+
+/**
+ *  Server-side lag compensation for hit validation
+ *  Records the capsules of registered characters every server frame and tests shots
+ *  against where targets were when the shooter saw them, rather than where they are now
+ */
+UCLASS()
+class SIMPLESHOOTER_API UShooterLagCompensation : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** One history per registered character */
+	TArray<FShooterHitboxHistory> Histories;
+
+	/** Maps each registered character to its history */
+	TMap<const ACharacter*, int32> HistoryIndices;
+
+	/** Scratch hitbox world the rewound capsules are gathered into, kept around to avoid allocating per shot */
+	mutable FShooterHitboxWorld RewoundHitboxes;
+
+protected:
+
+	/** Only create the lag compensation service for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Records a frame for every registered character */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns the stat ID for tick profiling */
+	virtual TStatId GetStatId() const override;
+
+	/** Starts recording the given character. Server only */
+	void RegisterCharacter(ACharacter* Character);
+
+	/** Stops recording the given character */
+	void UnregisterCharacter(ACharacter* Character);
+
+	/** Returns true if the given character is recorded */
+	bool IsRegistered(const ACharacter* Character) const { return HistoryIndices.Contains(Character); };
+
+	/** Adds every recorded character to the list */
+	void GetRegisteredCharacters(TArray<AActor*>& OutCharacters) const;
+
+	/** Feeds the measured delay of one of a character's fire inputs into its smoothed input delay, bounded by the character's round trip time */
+	void ReportInputDelay(const ACharacter* Character, float Delay);
+
+	/** Returns the one way time of the given shooter's shots to the server, measured from its fire input if possible, or half the round trip */
+	float GetShotOneWayTime(const APawn* Shooter) const;
+
+	/** Returns the server time the given shooter was seeing when it fired */
+	float GetShooterViewTime(const APawn* Shooter) const;
+
+	/** Returns how far ahead to launch projectiles fired by the given pawn, so they're where the shooter saw them. The shot's one way time, capped */
+	float GetProjectileFastForwardTime(const APawn* Shooter) const;
+
+	/** Returns true if shots by the given pawn need to be rewound. Only remote players are lag compensated */
+	bool ShouldCompensate(const APawn* Shooter) const;
+
+	/** Returns the interpolated capsule of the given character at the given time */
+	bool GetCapsuleAtTime(const ACharacter* Character, float Time, FShooterHitboxFrame& OutFrame, float& OutRadius) const;
+
+	/**
+	 *  Traces a segment against every recorded capsule, rewound to the given time
+	 *  Returns the closest hit. The shooter is always ignored
+	 */
+	bool TraceRewound(const FVector& Start, const FVector& End, float Time, const AActor* IgnoredActor, FHitResult& OutHit) const;
+
+	/**
+	 *  Traces several segments sharing a start against every recorded capsule, rewound to the given time
+	 *  The capsules are rewound once for the whole batch. Only the hits of segments that hit a capsule are overwritten
+	 */
+	void TraceRewoundMany(const FVector& Start, TConstArrayView<FVector> Ends, float Time, const AActor* IgnoredActor, TArrayView<FHitResult> InOutHits) const;
+
+protected:
+
+	/** Fills the rewound hitboxes with every recorded capsule as it was at the given time */
+	void RewindHitboxes(float Time, const AActor* IgnoredActor) const;
+
+	/** Builds a hit result against a rewound capsule */
+	FHitResult MakeRewoundHit(const FVector& Start, const FVector& End, const FShooterHitboxHit& HitboxHit) const;
+
+	/** Builds a frame from the current state of a capsule */
+	static FShooterHitboxFrame MakeFrame(const UCapsuleComponent* Capsule, float Time);
+};
@@ -7,8 +7,13 @@
 #include "Components/StaticMeshComponent.h"
 #include "ShooterWeaponHolder.h"
 #include "ShooterWeapon.h"
+#include "ShooterWeaponStats.h"
+#include "Engine/GameInstance.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
+#include "SimpleShooter.h"
 
 AShooterPickup::AShooterPickup()
 {
@@ -33,6 +38,18 @@ AShooterPickup::AShooterPickup()
 	// subscribe to the collision overlap on the sphere
 	SphereCollision->OnComponentBeginOverlap.AddDynamic(this, &AShooterPickup::OnOverlap);
 
+	// create the streaming sphere
+	StreamingSphere = CreateDefaultSubobject<USphereComponent>(TEXT("Streaming Sphere"));
+	StreamingSphere->SetupAttachment(SphereCollision);
+
+	StreamingSphere->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	StreamingSphere->SetCollisionObjectType(ECC_WorldStatic);
+	StreamingSphere->SetCollisionResponseToAllChannels(ECR_Ignore);
+	StreamingSphere->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+	StreamingSphere->SetCanEverAffectNavigation(false);
+
+	StreamingSphere->OnComponentBeginOverlap.AddDynamic(this, &AShooterPickup::OnStreamingOverlap);
+
 	// create the mesh
 	Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh"));
 	Mesh->SetupAttachment(SphereCollision);
@@ -44,21 +61,46 @@ void AShooterPickup::OnConstruction(const FTransform& Transform)
 {
 	Super::OnConstruction(Transform);
 
+	StreamingSphere->SetSphereRadius(StreamingRadius);
+
+	// game worlds stream the mesh in on BeginPlay
+	if (GetWorld() && GetWorld()->IsGameWorld())
+	{
+		Mesh->SetStaticMesh(PlaceholderMesh);
+		return;
+	}
+
+#if WITH_EDITOR
 	if (FWeaponTableRow* WeaponData = WeaponType.GetRow<FWeaponTableRow>(FString()))
 	{
-		// set the mesh
+		// set the mesh so it shows up in the editor
 		Mesh->SetStaticMesh(WeaponData->StaticMesh.LoadSynchronous());
 	}
+#endif
 }
 
 void AShooterPickup::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if (FWeaponTableRow* WeaponData = WeaponType.GetRow<FWeaponTableRow>(FString()))
+	// the weapon table was read once when the game started, so just copy our row's assets. Nothing is loaded until it's needed
+	if (UShooterWeaponStats* WeaponStats = GetGameInstance()->GetSubsystem<UShooterWeaponStats>())
 	{
-		// copy the weapon class
-		WeaponClass = WeaponData->WeaponToSpawn;
+		if (const FShooterWeaponTableEntry* Entry = WeaponStats->FindTableEntry(WeaponType.RowName))
+		{
+			PickupMesh = Entry->StaticMesh;
+			WeaponToSpawn = Entry->WeaponToSpawn;
+
+		} else {
+
+			UE_LOG(LogSimpleShooter, Warning, TEXT("ShooterPickup: %s offers %s, which isn't in the weapon table"), *GetName(), *WeaponType.RowName.ToString());
+		}
+	}
+
+	// the pickup is relevant to us now, so start streaming its visuals in. Dedicated servers never draw it
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		RequestMeshLoad();
 	}
 }
 
@@ -68,6 +110,19 @@ void AShooterPickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
 
 	// clear the respawn timer
 	GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
+
+	// let go of the streamed assets
+	if (MeshLoadHandle.IsValid())
+	{
+		MeshLoadHandle->CancelHandle();
+		MeshLoadHandle.Reset();
+	}
+
+	if (WeaponLoadHandle.IsValid())
+	{
+		WeaponLoadHandle->CancelHandle();
+		WeaponLoadHandle.Reset();
+	}
 }
 
 void AShooterPickup::OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
@@ -80,20 +135,110 @@ void AShooterPickup::OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor*
 	// have we collided against a weapon holder?
 	if (IShooterWeaponHolder* WeaponHolder = Cast<IShooterWeaponHolder>(OtherActor))
 	{
-		WeaponHolder->AddWeaponClass(WeaponClass);
+		// if the weapon is still streaming in, it'll be granted once it's ready
+		if (!WeaponClass)
+		{
+			RequestWeaponLoad();
+			return;
+		}
+
+		GrantWeapon(WeaponHolder);
+	}
+}
+
+void AShooterPickup::OnStreamingOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	// only the server grants weapons
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	// someone who could pick us up is getting close
+	if (Cast<IShooterWeaponHolder>(OtherActor))
+	{
+		RequestWeaponLoad();
+	}
+}
+
+void AShooterPickup::RequestMeshLoad()
+{
+	if (PickupMesh.IsNull() || MeshLoadHandle.IsValid())
+	{
+		return;
+	}
+
+	// show the placeholder while we wait
+	Mesh->SetStaticMesh(PlaceholderMesh);
+
+	MeshLoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(PickupMesh.ToSoftObjectPath(), FStreamableDelegate::CreateUObject(this, &AShooterPickup::OnMeshLoaded));
+}
+
+void AShooterPickup::OnMeshLoaded()
+{
+	if (UStaticMesh* LoadedMesh = PickupMesh.Get())
+	{
+		Mesh->SetStaticMesh(LoadedMesh);
+	}
+}
+
+void AShooterPickup::RequestWeaponLoad()
+{
+	if (WeaponClass || WeaponToSpawn.IsNull() || WeaponLoadHandle.IsValid())
+	{
+		return;
+	}
 
-		// hide this mesh
-		SetActorHiddenInGame(true);
+	WeaponLoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(WeaponToSpawn.ToSoftObjectPath(), FStreamableDelegate::CreateUObject(this, &AShooterPickup::OnWeaponClassLoaded));
+}
 
-		// disable collision
-		SetActorEnableCollision(false);
+void AShooterPickup::OnWeaponClassLoaded()
+{
+	WeaponClass = WeaponToSpawn.Get();
 
-		// disable ticking
-		SetActorTickEnabled(false);
+	if (!WeaponClass)
+	{
+		return;
+	}
 
-		// schedule the respawn
-		GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterPickup::RespawnPickup, RespawnTime, false);
+	// compile the weapon's stats now instead of on its first spawn
+	if (UShooterWeaponStats* WeaponStats = GetGameInstance()->GetSubsystem<UShooterWeaponStats>())
+	{
+		WeaponStats->RegisterWeaponClass(WeaponClass);
 	}
+
+	// hand the weapon to anyone who reached the pickup while it was loading
+	if (HasAuthority() && GetActorEnableCollision())
+	{
+		TArray<AActor*> OverlappingActors;
+		SphereCollision->GetOverlappingActors(OverlappingActors);
+
+		for (AActor* OverlappingActor : OverlappingActors)
+		{
+			if (IShooterWeaponHolder* WeaponHolder = Cast<IShooterWeaponHolder>(OverlappingActor))
+			{
+				GrantWeapon(WeaponHolder);
+				break;
+			}
+		}
+	}
+}
+
+void AShooterPickup::GrantWeapon(IShooterWeaponHolder* WeaponHolder)
+{
+	WeaponHolder->AddWeaponClass(WeaponClass);
+
+	// hide this mesh
+	SetActorHiddenInGame(true);
+
+	// disable collision
+	SetActorEnableCollision(false);
+
+	// disable ticking
+	SetActorTickEnabled(false);
+
+	// schedule the respawn
+	GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterPickup::RespawnPickup, RespawnTime, false);
 }
 
 void AShooterPickup::RespawnPickup()
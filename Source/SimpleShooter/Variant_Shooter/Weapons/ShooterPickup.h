@@ -11,6 +11,8 @@
 class USphereComponent;
 class UPrimitiveComponent;
 class AShooterWeapon;
+class IShooterWeaponHolder;
+struct FStreamableHandle;
 
 /**
  *  Holds information about a type of weapon pickup
@@ -24,9 +26,9 @@ struct FWeaponTableRow : public FTableRowBase
 	UPROPERTY(EditAnywhere)
 	TSoftObjectPtr<UStaticMesh> StaticMesh;
 
-	/** Weapon class to grant on pickup */
+	/** Weapon class to grant on pickup. Streamed in once a pickup offering it is approached, so only weapons in play stay resident */
 	UPROPERTY(EditAnywhere)
-	TSubclassOf<AShooterWeapon> WeaponToSpawn;
+	TSoftClassPtr<AShooterWeapon> WeaponToSpawn;
 };
 
 /**
@@ -44,15 +46,39 @@ class SIMPLESHOOTER_API AShooterPickup : public AActor
 	/** Weapon pickup mesh. Its mesh asset is set from the weapon data table */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	UStaticMeshComponent* Mesh;
+
+	/** Larger sphere that starts streaming the weapon class in when a pawn gets close */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	USphereComponent* StreamingSphere;
 	
 protected:
 
-	/** Data on the type of picked weapon and visuals of this pickup */
+	/** Data on the type of picked weapon and visuals of this pickup. Should be a row of the weapon table configured on UShooterWeaponStats */
 	UPROPERTY(EditAnywhere, Category="Pickup")
 	FDataTableRowHandle WeaponType;
 
-	/** Type to weapon to grant on pickup. Set from the weapon data table. */
+	/** Type to weapon to grant on pickup. Set once the weapon class from the data table has streamed in */
 	TSubclassOf<AShooterWeapon> WeaponClass;
+
+	/** Mesh to show until the pickup mesh from the data table has streamed in */
+	UPROPERTY(EditAnywhere, Category="Pickup")
+	TObjectPtr<UStaticMesh> PlaceholderMesh;
+
+	/** Distance at which an approaching pawn starts streaming the weapon class in */
+	UPROPERTY(EditAnywhere, Category="Pickup", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm"))
+	float StreamingRadius = 1500.0f;
+
+	/** Pickup mesh from the data table */
+	TSoftObjectPtr<UStaticMesh> PickupMesh;
+
+	/** Weapon class from the data table */
+	TSoftClassPtr<AShooterWeapon> WeaponToSpawn;
+
+	/** Keeps the streamed pickup mesh resident for as long as the pickup is around */
+	TSharedPtr<FStreamableHandle> MeshLoadHandle;
+
+	/** Keeps the streamed weapon class resident for as long as the pickup is around */
+	TSharedPtr<FStreamableHandle> WeaponLoadHandle;
 	
 	/** Time to wait before respawning this pickup */
 	UPROPERTY(EditAnywhere, Category="Pickup", meta = (ClampMin = 0, ClampMax = 120, Units = "s"))
@@ -81,8 +107,27 @@ protected:
 	UFUNCTION()
 	virtual void OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 
+	/** Starts streaming the weapon class in when a pawn gets close */
+	UFUNCTION()
+	void OnStreamingOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
 protected:
 
+	/** Starts streaming the pickup mesh in, showing the placeholder until it's ready */
+	void RequestMeshLoad();
+
+	/** Swaps the placeholder for the streamed pickup mesh */
+	void OnMeshLoaded();
+
+	/** Starts streaming the weapon class in, if it isn't already */
+	void RequestWeaponLoad();
+
+	/** Stores the streamed weapon class and hands it to anyone who reached the pickup while it was loading */
+	void OnWeaponClassLoaded();
+
+	/** Grants the weapon to a holder and starts the respawn */
+	void GrantWeapon(IShooterWeaponHolder* WeaponHolder);
+
 	/** Called when it's time to respawn this pickup */
 	void RespawnPickup();
 
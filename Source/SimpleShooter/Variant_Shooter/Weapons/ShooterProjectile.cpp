@@ -12,6 +12,12 @@
 #include "Engine/OverlapResult.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
+#include "ShooterProjectilePool.h"
+#include "ShooterExplosionResolver.h"
+#include "ShooterImpactEffects.h"
+#include "ShooterWeapon.h"
+#include "Perception/AISense_Hearing.h"
+#include <Net/UnrealNetwork.h>
 
 AShooterProjectile::AShooterProjectile()
 {
@@ -24,10 +30,13 @@ AShooterProjectile::AShooterProjectile()
 	RootComponent = CollisionComponent = CreateDefaultSubobject<USphereComponent>(TEXT("Collision Component"));
 
 	CollisionComponent->SetSphereRadius(16.0f);
-	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-	CollisionComponent->SetCollisionResponseToAllChannels(ECR_Block);
+	// move on the Projectile channel with query-only collision, so projectiles never get a physics body or collide with each other
+	CollisionComponent->SetCollisionProfileName(FName("Projectile"));
 	CollisionComponent->CanCharacterStepUpOn = ECanBeCharacterBase::ECB_No;
 
+	// report the surface we hit so the impact response table can pick the right effects
+	CollisionComponent->bReturnMaterialOnMove = true;
+
 	// create the projectile movement component. No need to attach it because it's not a Scene Component
 	ProjectileMovement = CreateDefaultSubobject<UProjectileMovementComponent>(TEXT("Projectile Movement"));
 
@@ -35,6 +44,11 @@ AShooterProjectile::AShooterProjectile()
 	ProjectileMovement->MaxSpeed = 3000.0f;
 	ProjectileMovement->bShouldBounce = true;
 
+	// move in fixed sub-steps, bounces included, so fast projectiles hit the same things at any tick rate
+	ProjectileMovement->bForceSubStepping = true;
+	ProjectileMovement->MaxSimulationTimeStep = 1.0f / 60.0f;
+	ProjectileMovement->MaxSimulationIterations = 8;
+
 	// set the default damage type
 	HitDamageType = UDamageType::StaticClass();
 }
@@ -45,6 +59,12 @@ void AShooterProjectile::BeginPlay()
 	
 	// ignore the pawn that shot this projectile
 	CollisionComponent->IgnoreActorWhenMoving(GetInstigator(), true);
+
+	// replicated projectiles may belong to a shot we predicted
+	if (!HasAuthority())
+	{
+		ClaimPredictedShot();
+	}
 }
 
 void AShooterProjectile::EndPlay(EEndPlayReason::Type EndPlayReason)
@@ -53,6 +73,12 @@ void AShooterProjectile::EndPlay(EEndPlayReason::Type EndPlayReason)
 
 	// clear the destruction timer
 	GetWorld()->GetTimerManager().ClearTimer(DestructionTimer);
+
+	// let the pool know we're gone
+	if (UShooterProjectilePool* OwningPool = Pool.Get())
+	{
+		OwningPool->NotifyProjectileDestroyed(this);
+	}
 }
 
 void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
@@ -63,11 +89,38 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 		return;
 	}
 
+	// bounce off the world until we run out of bounces. The movement component handles the bounce itself
+	if (BounceCount < MaxBounces && !Cast<APawn>(Other))
+	{
+		++BounceCount;
+		return;
+	}
+
 	bHit = true;
 
 	// disable collision on the projectile
 	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
+	// client-side simulations never apply damage
+	if (bCosmeticOnly)
+	{
+		if (bReplicateSpawnOnly)
+		{
+			// effects wait for the server to report the real impact
+			ProjectileMovement->StopMovementImmediately();
+			ProjectileMovement->Deactivate();
+
+		} else {
+
+			// predicted shots play their own effects, since the server copy is hidden from the shooter
+			PlayImpactEffects(Hit);
+		}
+
+		// clean up on our own in case the impact event never arrives
+		ScheduleDeferredDestruction();
+		return;
+	}
+
 	// make AI perception noise
 	MakeNoise(NoiseLoudness, GetInstigator(), GetActorLocation(), NoiseRange, NoiseTag);
 
@@ -84,28 +137,84 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 
 	}
 
-	// pass control to BP for any extra effects
-	BP_OnProjectileHit(Hit);
+	// play the impact effects
+	PlayImpactEffects(Hit);
+
+	// tell the clients simulating this shot where it really hit
+	if (bReplicateSpawnOnly && SourceWeapon.IsValid())
+	{
+		SourceWeapon->BroadcastProjectileImpact(ShotId, Hit);
+	}
 
 	// check if we should schedule deferred destruction of the projectile
-	if (DeferredDestructionTime > 0.0f)
+	ScheduleDeferredDestruction();
+}
+
+void AShooterProjectile::PlayImpactEffects(const FHitResult& Hit)
+{
+	// the native response table plays the effects if it has an entry for this hit
+	if (UShooterImpactEffects* ImpactEffects = GetWorld()->GetSubsystem<UShooterImpactEffects>())
 	{
-		GetWorld()->GetTimerManager().SetTimer(DestructionTimer, this, &AShooterProjectile::OnDeferredDestruction, DeferredDestructionTime, false);
+		if (ImpactEffects->QueueImpact(GetClass(), Hit))
+		{
+			return;
+		}
+	}
 
-	} else {
+	// otherwise pass control to BP
+	BP_OnProjectileHit(Hit);
+}
 
-		// destroy the projectile right away
-		Destroy();
+void AShooterProjectile::FellOutOfWorld(const UDamageType& DmgType)
+{
+	// pooled projectiles go back to the pool instead of being destroyed
+	if (Pool.IsValid())
+	{
+		ReturnToPoolOrDestroy();
+		return;
 	}
+
+	Super::FellOutOfWorld(DmgType);
 }
 
 void AShooterProjectile::ExplosionCheck(const FVector& ExplosionCenter)
 {
+	ApplyExplosion(MakeImpactParams(), ExplosionCenter);
+}
+
+void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection)
+{
+	ApplyHit(MakeImpactParams(), HitActor, HitComp, HitLocation, HitDirection);
+}
+
+void AShooterProjectile::ResolveImpact(const FShooterProjectileImpactParams& Params, const FHitResult& Hit)
+{
+	if (Params.Settings->bExplodeOnHit)
+	{
+		// apply explosion damage centered on the impact
+		ApplyExplosion(Params, Hit.Location);
+
+	} else {
+
+		// single hit projectile. Process the collided actor
+		ApplyHit(Params, Hit.GetActor(), Hit.GetComponent(), Hit.ImpactPoint, -Hit.ImpactNormal);
+	}
+}
+
+void AShooterProjectile::ApplyExplosion(const FShooterProjectileImpactParams& Params, const FVector& ExplosionCenter)
+{
+	// batch the explosion with the rest of the frame's if we have a resolver
+	if (UShooterExplosionResolver* Resolver = Params.World->GetSubsystem<UShooterExplosionResolver>())
+	{
+		Resolver->QueueExplosion(Params, ExplosionCenter);
+		return;
+	}
+
 	// do a sphere overlap check look for nearby actors to damage
 	TArray<FOverlapResult> Overlaps;
 
 	FCollisionShape OverlapShape;
-	OverlapShape.SetSphere(ExplosionRadius);
+	OverlapShape.SetSphere(Params.Settings->ExplosionRadius);
 
 	FCollisionObjectQueryParams ObjectParams;
 	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
@@ -113,64 +222,301 @@ void AShooterProjectile::ExplosionCheck(const FVector& ExplosionCenter)
 	ObjectParams.AddObjectTypesToQuery(ECC_PhysicsBody);
 
 	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(this);
-	if (!bDamageOwner)
+	if (Params.DamageCauser != Params.Instigator)
 	{
-		QueryParams.AddIgnoredActor(GetInstigator());
+		QueryParams.AddIgnoredActor(Params.DamageCauser);
+	}
+	if (!Params.Settings->bDamageOwner)
+	{
+		QueryParams.AddIgnoredActor(Params.Instigator);
 	}
 
-	GetWorld()->OverlapMultiByObjectType(Overlaps, ExplosionCenter, FQuat::Identity, ObjectParams, OverlapShape, QueryParams);
+	Params.World->OverlapMultiByObjectType(Overlaps, ExplosionCenter, FQuat::Identity, ObjectParams, OverlapShape, QueryParams);
 
-	TArray<AActor*> DamagedActors;
+	// overlaps may return the same actor multiple times per each component overlapped
+	// ensure we only damage each actor once by adding it to a damaged set
+	TSet<AActor*> DamagedActors;
+	DamagedActors.Reserve(Overlaps.Num());
 
 	// process the overlap results
 	for (const FOverlapResult& CurrentOverlap : Overlaps)
 	{
-		// overlaps may return the same actor multiple times per each component overlapped
-		// ensure we only damage each actor once by adding it to a damaged list
-		if (DamagedActors.Find(CurrentOverlap.GetActor()) == INDEX_NONE)
-		{
-			DamagedActors.Add(CurrentOverlap.GetActor());
+		bool bAlreadyDamaged = false;
+		DamagedActors.Add(CurrentOverlap.GetActor(), &bAlreadyDamaged);
 
+		if (!bAlreadyDamaged)
+		{
 			// apply physics force away from the explosion
-			const FVector& ExplosionDir = CurrentOverlap.GetActor()->GetActorLocation() - GetActorLocation();
+			const FVector& ExplosionDir = CurrentOverlap.GetActor()->GetActorLocation() - ExplosionCenter;
 
 			// push and/or damage the overlapped actor
-			ProcessHit(CurrentOverlap.GetActor(), CurrentOverlap.GetComponent(), GetActorLocation(), ExplosionDir.GetSafeNormal());
+			ApplyHit(Params, CurrentOverlap.GetActor(), CurrentOverlap.GetComponent(), ExplosionCenter, ExplosionDir.GetSafeNormal());
 		}
-			
 	}
 }
 
-void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection)
+void AShooterProjectile::ApplyHit(const FShooterProjectileImpactParams& Params, AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection)
 {
 
 	// have we hit a character?
 	if (ACharacter* HitCharacter = Cast<ACharacter>(HitActor))
 	{
-		if (!HasAuthority())
+		if (!Params.bHasAuthority)
 		{
 			return;
 		}
 
 		// ignore the owner of this projectile
-		if (HitCharacter != GetOwner() || bDamageOwner)
+		if (HitCharacter != Params.Instigator || Params.Settings->bDamageOwner)
 		{
 			// apply damage to the character
-			UGameplayStatics::ApplyDamage(HitCharacter, HitDamage, GetInstigator()->GetController(), this, HitDamageType);
+			AController* InstigatorController = Params.Instigator ? Params.Instigator->GetController() : nullptr;
+			UGameplayStatics::ApplyDamage(HitCharacter, Params.Damage, InstigatorController, Params.DamageCauser, Params.Settings->HitDamageType);
 		}
 	}
 
 	// have we hit a physics object?
-	if (HitComp->IsSimulatingPhysics())
+	if (HitComp && HitComp->IsSimulatingPhysics())
 	{
 		// give some physics impulse to the object
-		HitComp->AddImpulseAtLocation(HitDirection * PhysicsForce, HitLocation);
+		HitComp->AddImpulseAtLocation(HitDirection * Params.Settings->PhysicsForce * Params.ImpulseScale, HitLocation);
 	}
 }
 
+void AShooterProjectile::ReportImpactNoise(const FShooterProjectileImpactParams& Params, const FVector& NoiseLocation)
+{
+	UAISense_Hearing::ReportNoiseEvent(Params.World, NoiseLocation, Params.Settings->NoiseLoudness, Params.Instigator, Params.Settings->NoiseRange, Params.Settings->NoiseTag);
+}
+
+FShooterProjectileImpactParams AShooterProjectile::MakeImpactParams() const
+{
+	FShooterProjectileImpactParams Params;
+	Params.World = GetWorld();
+	Params.Settings = this;
+	Params.Instigator = GetInstigator();
+	Params.DamageCauser = const_cast<AShooterProjectile*>(this);
+	Params.Damage = HitDamage;
+	Params.bHasAuthority = HasAuthority();
+
+	return Params;
+}
+
 void AShooterProjectile::OnDeferredDestruction()
 {
 	// destroy this actor
-	Destroy();
+	ReturnToPoolOrDestroy();
+}
+
+void AShooterProjectile::ScheduleDeferredDestruction()
+{
+	if (DeferredDestructionTime > 0.0f)
+	{
+		GetWorld()->GetTimerManager().SetTimer(DestructionTimer, this, &AShooterProjectile::OnDeferredDestruction, DeferredDestructionTime, false);
+
+	} else {
+
+		// destroy the projectile right away
+		ReturnToPoolOrDestroy();
+	}
+}
+
+void AShooterProjectile::SetShotInfo(AShooterWeapon* Weapon, uint16 InShotId)
+{
+	SourceWeapon = Weapon;
+	ShotId = InShotId;
+}
+
+void AShooterProjectile::AdvanceProjectile(float Seconds)
+{
+	if (Seconds <= 0.0f)
+	{
+		return;
+	}
+
+	// follow the ballistic arc for the given time
+	const FVector Gravity(0.0f, 0.0f, ProjectileMovement->GetGravityZ());
+	const FVector LaunchVelocity = ProjectileMovement->Velocity;
+	const FVector Delta = (LaunchVelocity * Seconds) + (Gravity * (0.5f * Seconds * Seconds));
+
+	ProjectileMovement->Velocity = LaunchVelocity + (Gravity * Seconds);
+
+	// sweep the whole catch-up segment at once. A blocking hit is dispatched to NotifyHit like regular movement
+	FHitResult Hit;
+	ProjectileMovement->SafeMoveUpdatedComponent(Delta, GetActorQuat(), true, Hit);
+
+	// let the movement component bounce or stop off the surface with the velocity we had when we reached it, and spend the rest of the catch-up time
+	if (Hit.bBlockingHit)
+	{
+		ProjectileMovement->Velocity = LaunchVelocity + (Gravity * (Seconds * Hit.Time));
+		ProjectileMovement->HandleImpact(Hit, Seconds * (1.0f - Hit.Time), Delta);
+	}
+}
+
+void AShooterProjectile::PlayAuthoritativeImpact(const FVector& ImpactLocation, const FVector& ImpactNormal)
+{
+	bHit = true;
+
+	// stop the local simulation
+	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+
+	// snap to where the server says we hit
+	SetActorLocation(ImpactLocation, false, nullptr, ETeleportType::TeleportPhysics);
+
+	FHitResult Hit;
+	Hit.bBlockingHit = true;
+	Hit.Location = Hit.ImpactPoint = ImpactLocation;
+	Hit.Normal = Hit.ImpactNormal = ImpactNormal;
+
+	// play the impact effects
+	PlayImpactEffects(Hit);
+
+	// restart the destruction timer from the real impact
+	GetWorld()->GetTimerManager().ClearTimer(DestructionTimer);
+	ScheduleDeferredDestruction();
+}
+
+void AShooterProjectile::HideForPredictedShot()
+{
+	// keep it from hitting anything on our end so the effects don't play twice
+	bHit = true;
+	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	SetActorHiddenInGame(true);
+}
+
+void AShooterProjectile::ClaimPredictedShot()
+{
+	if (AShooterWeapon* Weapon = SourceWeapon.Get())
+	{
+		Weapon->ReconcilePredictedProjectile(this);
+	}
+}
+
+void AShooterProjectile::ReturnToPoolOrDestroy()
+{
+	if (UShooterProjectilePool* OwningPool = Pool.Get())
+	{
+		// only the server owns the pool. Clients wait for the parked state to replicate
+		if (HasAuthority())
+		{
+			OwningPool->ReleaseProjectile(this);
+		}
+
+	} else {
+
+		Destroy();
+	}
+}
+
+void AShooterProjectile::OnAcquiredFromPool(const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator)
+{
+	bInPool = false;
+
+	// forget the previous shot
+	bCosmeticOnly = false;
+	SourceWeapon = nullptr;
+	ShotId = 0;
+
+	// wake up so the new flight replicates
+	SetNetDormancy(DORM_Awake);
+
+	// set the new owner and instigator
+	SetOwner(NewOwner);
+	SetInstigator(NewInstigator);
+
+	// move to the spawn point without sweeping or carrying over any physics state
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+
+	// bump the generation so clients reset their hit state too
+	++PoolGeneration;
+
+	ResetHitState();
+
+	// show the projectile and let it tick again
+	SetActorHiddenInGame(false);
+	SetActorTickEnabled(true);
+
+	// restart the movement the same way the component initializes it on spawn
+	const UProjectileMovementComponent* DefaultMovement = GetClass()->GetDefaultObject<AShooterProjectile>()->ProjectileMovement;
+
+	FVector InitialVelocity = DefaultMovement->Velocity;
+
+	if (ProjectileMovement->InitialSpeed > 0.0f)
+	{
+		InitialVelocity = InitialVelocity.GetSafeNormal() * ProjectileMovement->InitialSpeed;
+	}
+
+	ProjectileMovement->SetUpdatedComponent(CollisionComponent);
+	ProjectileMovement->Activate(true);
+
+	if (ProjectileMovement->bInitialVelocityInLocalSpace)
+	{
+		ProjectileMovement->SetVelocityInLocalSpace(InitialVelocity);
+
+	} else {
+
+		ProjectileMovement->Velocity = InitialVelocity;
+	}
+
+	ProjectileMovement->UpdateComponentVelocity();
+
+	ForceNetUpdate();
+}
+
+void AShooterProjectile::OnReleasedToPool()
+{
+	bInPool = true;
+
+	// clear the destruction timer
+	GetWorld()->GetTimerManager().ClearTimer(DestructionTimer);
+
+	// stop moving
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+
+	// disable collision
+	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	// hide the projectile and stop ticking
+	SetActorHiddenInGame(true);
+	SetActorTickEnabled(false);
+
+	// go dormant once the parked state has replicated, so idle projectiles cost no bandwidth
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void AShooterProjectile::ResetHitState()
+{
+	bHit = false;
+	BounceCount = 0;
+
+	// restore the collision settings we were spawned with
+	CollisionComponent->SetCollisionEnabled(GetClass()->GetDefaultObject<AShooterProjectile>()->CollisionComponent->GetCollisionEnabled());
+
+	// ignore the pawn that shot this projectile
+	CollisionComponent->ClearMoveIgnoreActors();
+	CollisionComponent->IgnoreActorWhenMoving(GetInstigator(), true);
+}
+
+void AShooterProjectile::OnRep_PoolGeneration()
+{
+	// the server handed this projectile out again, so it can hit things once more
+	ResetHitState();
+
+	// a previous shot may have hidden us from the shooter
+	SetActorHiddenInGame(false);
+
+	// the new flight may belong to a shot we predicted
+	ClaimPredictedShot();
+}
+
+void AShooterProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AShooterProjectile, PoolGeneration);
+	DOREPLIFETIME_CONDITION(AShooterProjectile, SourceWeapon, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AShooterProjectile, ShotId, COND_OwnerOnly);
 }
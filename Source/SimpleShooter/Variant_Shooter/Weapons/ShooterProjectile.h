@@ -10,6 +10,36 @@ class USphereComponent;
 class UProjectileMovementComponent;
 class ACharacter;
 class UPrimitiveComponent;
+class UShooterProjectilePool;
+class AShooterProjectile;
+class AShooterWeapon;
+
+/**
+ *  Everything needed to resolve a projectile impact, with or without a projectile actor
+ */
+struct FShooterProjectileImpactParams
+{
+	/** World the impact happens in */
+	UWorld* World = nullptr;
+
+	/** Projectile providing the damage, explosion and impulse tuning. May be a class default object */
+	const AShooterProjectile* Settings = nullptr;
+
+	/** Pawn that shot the projectile */
+	APawn* Instigator = nullptr;
+
+	/** Actor reported as the cause of the damage */
+	AActor* DamageCauser = nullptr;
+
+	/** Damage to apply to a hit character */
+	float Damage = 0.0f;
+
+	/** Multiplier on the physics impulse, used when several hits are applied as one */
+	float ImpulseScale = 1.0f;
+
+	/** If true, damage is applied. Without authority only physics impulses are applied */
+	bool bHasAuthority = false;
+};
 
 /**
  *  Simple projectile class for a first person shooter game
@@ -57,6 +87,36 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Projectile|Hit")
 	bool bDamageOwner = false;
 
+	/** Number of times the projectile can bounce off the world before a hit counts. Hitting a pawn always counts */
+	UPROPERTY(EditAnywhere, Category="Projectile|Hit", meta = (ClampMin = 0, ClampMax = 10))
+	int32 MaxBounces = 0;
+
+	/** Number of times the projectile has bounced so far */
+	int32 BounceCount = 0;
+
+	/** If true, projectiles of this class are simulated in bulk by the projectile simulation subsystem instead of spawning an actor per shot */
+	UPROPERTY(EditDefaultsOnly, Category="Projectile|Simulation")
+	bool bUseBatchedSimulation = false;
+
+	/** If true, batched projectiles of this class integrate and sweep on the async physics thread at its fixed step. Requires async physics ticking in the project settings */
+	UPROPERTY(EditDefaultsOnly, Category="Projectile|Simulation", meta = (EditCondition = "bUseBatchedSimulation"))
+	bool bSimulateOnPhysicsThread = false;
+
+	/** If true, only a compact spawn record and the final impact are replicated. Clients simulate the flight locally */
+	UPROPERTY(EditDefaultsOnly, Category="Projectile|Replication")
+	bool bReplicateSpawnOnly = false;
+
+	/** If true, this is a client-side simulation of a shot. It never applies damage and waits for the server to report the impact */
+	bool bCosmeticOnly = false;
+
+	/** Weapon that fired this projectile. Replicated to the shooter so it can match the projectile with its prediction */
+	UPROPERTY(Replicated)
+	TWeakObjectPtr<AShooterWeapon> SourceWeapon;
+
+	/** ID of the shot this projectile belongs to, unique per weapon */
+	UPROPERTY(Replicated)
+	uint16 ShotId = 0;
+
 	/** If true, the projectile will explode and apply radial damage to all actors in range */
 	UPROPERTY(EditAnywhere, Category="Projectile|Explosion")
 	bool bExplodeOnHit = false;
@@ -75,6 +135,16 @@ protected:
 	/** Timer to handle deferred destruction of this projectile */
 	FTimerHandle DestructionTimer;
 
+	/** Pool this projectile belongs to, if it was spawned by one */
+	TWeakObjectPtr<UShooterProjectilePool> Pool;
+
+	/** If true, this projectile is parked in its pool waiting to be handed out */
+	bool bInPool = false;
+
+	/** Incremented each time the pool hands this projectile out, so clients can reset their hit state */
+	UPROPERTY(ReplicatedUsing = OnRep_PoolGeneration)
+	uint8 PoolGeneration = 0;
+
 public:	
 
 	/** Constructor */
@@ -91,6 +161,94 @@ protected:
 	/** Handles collision */
 	virtual void NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
 
+	/** Returns pooled projectiles to their pool instead of destroying them */
+	virtual void FellOutOfWorld(const UDamageType& DmgType) override;
+
+public:
+
+	/** Sets the pool that owns this projectile. Must be called before the projectile begins play */
+	void SetPool(UShooterProjectilePool* InPool) { Pool = InPool; };
+
+	/** Returns true if this projectile is parked in its pool */
+	bool IsInPool() const { return bInPool; };
+
+	/** Resets this projectile to its spawn state after being handed out by the pool */
+	void OnAcquiredFromPool(const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator);
+
+	/** Disables this projectile while it waits in the pool */
+	void OnReleasedToPool();
+
+	/** Sets the weapon and shot this projectile belongs to */
+	void SetShotInfo(AShooterWeapon* Weapon, uint16 InShotId);
+
+	/** Returns the ID of the shot this projectile belongs to */
+	uint16 GetShotId() const { return ShotId; };
+
+	/** Flags this projectile as a client-side simulation that never applies damage */
+	void SetCosmeticOnly(bool bInCosmeticOnly) { bCosmeticOnly = bInCosmeticOnly; };
+
+	/** Moves the projectile ahead along its trajectory with a single sweep, as if it had been flying for the given time */
+	void AdvanceProjectile(float Seconds);
+
+	/** Snaps a client-side simulated projectile to the impact reported by the server and plays the hit effects */
+	void PlayAuthoritativeImpact(const FVector& ImpactLocation, const FVector& ImpactNormal);
+
+	/** Hides this replicated projectile from the shooter, who is already showing a predicted copy of the shot */
+	void HideForPredictedShot();
+
+public:
+
+	/** Resolves an impact: explodes or damages the hit actor depending on the projectile settings */
+	static void ResolveImpact(const FShooterProjectileImpactParams& Params, const FHitResult& Hit);
+
+	/** Looks up actors within the explosion radius of the projectile settings and damages them */
+	static void ApplyExplosion(const FShooterProjectileImpactParams& Params, const FVector& ExplosionCenter);
+
+	/** Damages and pushes a single hit actor */
+	static void ApplyHit(const FShooterProjectileImpactParams& Params, AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection);
+
+	/** Reports the AI perception noise for an impact of the projectile settings */
+	static void ReportImpactNoise(const FShooterProjectileImpactParams& Params, const FVector& NoiseLocation);
+
+	/** Builds the impact parameters for this projectile actor */
+	FShooterProjectileImpactParams MakeImpactParams() const;
+
+	/** Returns the collision component */
+	USphereComponent* GetCollisionComponent() const { return CollisionComponent; };
+
+	/** Returns the projectile movement component */
+	UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; };
+
+	/** Returns the damage applied on hit */
+	float GetHitDamage() const { return HitDamage; };
+
+	/** Returns the type of damage applied on hit */
+	TSubclassOf<UDamageType> GetHitDamageType() const { return HitDamageType; };
+
+	/** Returns the physics force applied on hit */
+	float GetPhysicsForce() const { return PhysicsForce; };
+
+	/** Returns true if the projectile explodes on hit */
+	bool ExplodesOnHit() const { return bExplodeOnHit; };
+
+	/** Returns the explosion radius */
+	float GetExplosionRadius() const { return ExplosionRadius; };
+
+	/** Returns true if the projectile can damage the character that shot it */
+	bool CanDamageOwner() const { return bDamageOwner; };
+
+	/** Returns the max number of bounces before a hit counts */
+	int32 GetMaxBounces() const { return MaxBounces; };
+
+	/** Returns true if this projectile class should be simulated in bulk */
+	bool UsesBatchedSimulation() const { return bUseBatchedSimulation; };
+
+	/** Returns true if batched projectiles of this class should be simulated on the physics thread */
+	bool SimulatesOnPhysicsThread() const { return bUseBatchedSimulation && bSimulateOnPhysicsThread; };
+
+	/** Returns true if this projectile class only replicates its spawn and impact */
+	bool ReplicatesSpawnOnly() const { return bReplicateSpawnOnly; };
+
 protected:
 
 	/** Looks up actors within the explosion radius and damages them */
@@ -99,11 +257,31 @@ protected:
 	/** Processes a projectile hit for the given actor */
 	void ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection);
 
-	/** Passes control to Blueprint to implement any effects on hit. */
+	/** Plays the impact effects through the impact response table, or Blueprint if the table has none for this hit */
+	void PlayImpactEffects(const FHitResult& Hit);
+
+	/** Passes control to Blueprint to implement any effects on hit. Only called for hits the impact response table doesn't cover */
 	UFUNCTION(BlueprintImplementableEvent, Category="Projectile", meta = (DisplayName = "On Projectile Hit"))
 	void BP_OnProjectileHit(const FHitResult& Hit);
 
 	/** Called from the destruction timer to destroy this projectile */
 	void OnDeferredDestruction();
 
+	/** Starts the deferred destruction timer, or destroys the projectile right away if there's no delay */
+	void ScheduleDeferredDestruction();
+
+	/** Returns this projectile to its pool, or destroys it if it isn't pooled */
+	void ReturnToPoolOrDestroy();
+
+	/** Clears the hit flag and restores collision so the projectile can hit again */
+	void ResetHitState();
+
+	/** Lets the weapon that fired this replicated projectile match it with the shooter's prediction */
+	void ClaimPredictedShot();
+
+protected:
+	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const;
+
+	UFUNCTION()
+	void OnRep_PoolGeneration();
 };
@@ -0,0 +1,165 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterProjectileAsyncCallback.h"
+#include "ShooterProjectile.h"
+
+FName FShooterProjectileAsyncCallback::GetFNameForStatId() const
+{
+	const static FLazyName StaticName("FShooterProjectileAsyncCallback");
+	return StaticName;
+}
+
+void FShooterProjectileAsyncCallback::OnPreSimulate_Internal()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FShooterProjectileAsyncCallback::OnPreSimulate_Internal);
+
+	FShooterProjectileAsyncOutput& Output = GetProducerOutputData_Internal();
+
+	// every sub-step of a frame sees the same input, so only consume it once
+	if (const FShooterProjectileAsyncInput* Input = GetConsumerInput_Internal())
+	{
+		if (Input->Sequence != LastInputSequence)
+		{
+			ConsumeInput(*Input, Output);
+			LastInputSequence = Input->Sequence;
+		}
+	}
+
+	const float DeltaTime = GetDeltaTime_Internal();
+	SimTime += DeltaTime;
+
+	for (TPair<const AShooterProjectile*, FShooterProjectileBatch>& Pair : Batches)
+	{
+		if (Pair.Value.Num() > 0)
+		{
+			AdvanceBatch(Pair.Value, DeltaTime, Output);
+		}
+	}
+}
+
+void FShooterProjectileAsyncCallback::ConsumeInput(const FShooterProjectileAsyncInput& Input, FShooterProjectileAsyncOutput& Output)
+{
+	for (const TPair<const AShooterProjectile*, FShooterProjectileStepSettings>& NewClass : Input.NewClasses)
+	{
+		FShooterProjectileBatch& Batch = Batches.FindOrAdd(NewClass.Key);
+		Batch.Settings = NewClass.Key;
+		Batch.StepSettings = NewClass.Value;
+	}
+
+	// apply corrections before adding launches, so removing with swap never moves a new projectile into the settled range
+	for (const FShooterProjectileAsyncCorrection& Correction : Input.Corrections)
+	{
+		// the game thread ignores the projectile's segments until it hears back, even if it's already gone
+		Output.CorrectedIds.Add(Correction.ProjectileId);
+
+		FShooterProjectileBatch* Batch = Batches.Find(Correction.Settings);
+		const int32 Index = Batch ? Batch->ProjectileIds.Find(Correction.ProjectileId) : INDEX_NONE;
+
+		if (Index == INDEX_NONE)
+		{
+			continue;
+		}
+
+		if (Correction.NewProjectileId == 0)
+		{
+			Batch->RemoveAtSwap(Index);
+			Batch->NumSettled = FMath::Min(Batch->NumSettled, Batch->Num());
+			continue;
+		}
+
+		// we kept flying past the bounce while the game thread swept, so rewind to it and catch up
+		const float CatchUpTime = static_cast<float>(FMath::Max(SimTime - Correction.HitTime, 0.0));
+
+		Batch->ProjectileIds[Index] = Correction.NewProjectileId;
+		Batch->Positions[Index] = Correction.Position;
+		Batch->Velocities[Index] = Correction.Velocity;
+		Batch->BounceCounts[Index] = Correction.BounceCount;
+		Batch->Ages[Index] = FMath::Max(Batch->Ages[Index] - CatchUpTime, 0.0f);
+		Batch->PendingTimes[Index] = CatchUpTime;
+	}
+
+	for (const FShooterProjectileAsyncLaunch& Launch : Input.Launches)
+	{
+		FShooterProjectileBatch* Batch = Batches.Find(Launch.Settings);
+
+		if (ensure(Batch))
+		{
+			// owner and damage live on the game thread, which resolves the hits
+			Batch->Add(Launch.Position, Launch.Velocity, nullptr, 0, nullptr, 0.0f, 0, Launch.TimeSinceShot, Launch.ProjectileId);
+		}
+	}
+}
+
+void FShooterProjectileAsyncCallback::AdvanceBatch(FShooterProjectileBatch& Batch, float DeltaTime, FShooterProjectileAsyncOutput& Output) const
+{
+	const FShooterProjectileStepSettings& StepSettings = Batch.StepSettings;
+
+	// projectiles launched since the last step already owe the time since their shot
+	for (int32 i = 0; i < Batch.NumSettled; ++i)
+	{
+		Batch.PendingTimes[i] += DeltaTime;
+	}
+
+	int32 NumDue = 0;
+
+	for (const float PendingTime : Batch.PendingTimes)
+	{
+		NumDue += PendingTime >= StepSettings.StepTime ? 1 : 0;
+	}
+
+	// same fixed sub-steps as the game thread simulation, minus the sweeps
+	for (int32 Step = 0; Step < StepSettings.MaxSteps && NumDue > 0; ++Step)
+	{
+		UShooterProjectileSimulation::IntegrateBatch(Batch);
+
+		NumDue = 0;
+
+		for (int32 i = Batch.Num() - 1; i >= 0; --i)
+		{
+			const float StepTime = Batch.GetStepTime(i);
+
+			if (StepTime <= 0.0f)
+			{
+				continue;
+			}
+
+			// hand the segment to the game thread to sweep
+			FShooterProjectileAsyncSegment& Segment = Output.Segments.AddDefaulted_GetRef();
+			Segment.Settings = Batch.Settings;
+			Segment.ProjectileId = Batch.ProjectileIds[i];
+			Segment.Start = Batch.Positions[i];
+			Segment.End = Batch.EndPositions[i];
+			Segment.StartVelocity = Batch.Velocities[i];
+			Segment.EndVelocity = Batch.EndVelocities[i];
+			Segment.StartTime = SimTime - Batch.PendingTimes[i];
+			Segment.StepTime = StepTime;
+
+			// commit the step. A hit found on the game thread comes back as a correction
+			Batch.Positions[i] = Batch.EndPositions[i];
+			Batch.Velocities[i] = Batch.EndVelocities[i];
+			Batch.Ages[i] += StepTime;
+			Batch.PendingTimes[i] -= StepTime;
+
+			// retire projectiles that flew for too long or fell out of the world
+			if (Batch.Ages[i] > StepSettings.Lifetime || Batch.Positions[i].Z < StepSettings.KillZ)
+			{
+				Output.RetiredIds.Add(Batch.ProjectileIds[i]);
+				Batch.RemoveAtSwap(i);
+				continue;
+			}
+
+			NumDue += Batch.PendingTimes[i] >= StepSettings.StepTime ? 1 : 0;
+		}
+	}
+
+	// don't let a long hitch snowball into more and more owed steps
+	const float MaxPendingTime = StepSettings.StepTime * StepSettings.MaxSteps;
+
+	for (float& PendingTime : Batch.PendingTimes)
+	{
+		PendingTime = FMath::Min(PendingTime, MaxPendingTime);
+	}
+
+	Batch.NumSettled = Batch.Num();
+}
@@ -0,0 +1,169 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/SimCallbackObject.h"
+#include "Chaos/SimCallbackInput.h"
+#include "ShooterProjectileSimulation.h"
+
+/**
+ *  Projectile launched on the game thread and handed over to the physics thread
+ */
+struct FShooterProjectileAsyncLaunch
+{
+	/** Class defaults of the projectile. Only used as a key on the physics thread */
+	const AShooterProjectile* Settings = nullptr;
+
+	/** ID the game thread gave the projectile */
+	uint32 ProjectileId = 0;
+
+	/** Launch location */
+	FVector Position = FVector::ZeroVector;
+
+	/** Launch velocity */
+	FVector Velocity = FVector::ZeroVector;
+
+	/** Time since the projectile was fired */
+	float TimeSinceShot = 0.0f;
+};
+
+/**
+ *  Change to a projectile decided on the game thread after sweeping one of its segments
+ */
+struct FShooterProjectileAsyncCorrection
+{
+	/** Class defaults of the projectile. Only used as a key on the physics thread */
+	const AShooterProjectile* Settings = nullptr;
+
+	/** ID of the projectile to correct */
+	uint32 ProjectileId = 0;
+
+	/** ID the projectile continues under after a bounce. 0 retires it */
+	uint32 NewProjectileId = 0;
+
+	/** Location of the bounce */
+	FVector Position = FVector::ZeroVector;
+
+	/** Velocity leaving the bounce */
+	FVector Velocity = FVector::ZeroVector;
+
+	/** Bounces so far, including this one */
+	uint8 BounceCount = 0;
+
+	/** Physics simulation time of the bounce. The projectile catches up from here to the current physics time */
+	double HitTime = 0.0;
+};
+
+/**
+ *  Movement of a projectile over one fixed sub-step, swept on the game thread
+ */
+struct FShooterProjectileAsyncSegment
+{
+	/** Class defaults of the projectile */
+	const AShooterProjectile* Settings = nullptr;
+
+	/** ID of the projectile */
+	uint32 ProjectileId = 0;
+
+	/** Location at the start of the step */
+	FVector Start = FVector::ZeroVector;
+
+	/** Location at the end of the step */
+	FVector End = FVector::ZeroVector;
+
+	/** Velocity at the start of the step */
+	FVector StartVelocity = FVector::ZeroVector;
+
+	/** Velocity at the end of the step */
+	FVector EndVelocity = FVector::ZeroVector;
+
+	/** Physics simulation time at the start of the step */
+	double StartTime = 0.0;
+
+	/** Time covered by the step */
+	float StepTime = 0.0f;
+};
+
+/**
+ *  Everything the game thread sends to the physics thread simulation
+ */
+struct FShooterProjectileAsyncInput : public Chaos::FSimCallbackInput
+{
+	/** Identifies this input, so sub-steps sharing it only consume it once */
+	uint32 Sequence = 0;
+
+	/** Step settings of classes launched for the first time */
+	TArray<TPair<const AShooterProjectile*, FShooterProjectileStepSettings>> NewClasses;
+
+	/** Projectiles launched since the last input was consumed */
+	TArray<FShooterProjectileAsyncLaunch> Launches;
+
+	/** Bounces and hits found since the last input was consumed */
+	TArray<FShooterProjectileAsyncCorrection> Corrections;
+
+	/** Clears the input for reuse */
+	void Reset()
+	{
+		Sequence = 0;
+		NewClasses.Reset();
+		Launches.Reset();
+		Corrections.Reset();
+	}
+};
+
+/**
+ *  Everything a physics step sends back to the game thread
+ */
+struct FShooterProjectileAsyncOutput : public Chaos::FSimCallbackOutput
+{
+	/** Movement segments of this step, in step order */
+	TArray<FShooterProjectileAsyncSegment> Segments;
+
+	/** Projectiles retired this step for flying too long or falling out of the world */
+	TArray<uint32> RetiredIds;
+
+	/** Projectiles whose correction was applied this step, or that were already gone when it arrived */
+	TArray<uint32> CorrectedIds;
+
+	/** Clears the output for reuse */
+	void Reset()
+	{
+		Segments.Reset();
+		RetiredIds.Reset();
+		CorrectedIds.Reset();
+	}
+};
+
+/**
+ *  Integrates batched projectiles on the physics thread at the fixed async physics step
+ *  Launches and corrections arrive through the callback input. No scene queries run here: each step's movement
+ *  segments are marshalled back to the game thread, which sweeps them against its own scene and resolves the hits
+ */
+class FShooterProjectileAsyncCallback : public Chaos::TSimCallbackObject<FShooterProjectileAsyncInput, FShooterProjectileAsyncOutput>
+{
+	/** Batches owned by the physics thread, one per class */
+	TMap<const AShooterProjectile*, FShooterProjectileBatch> Batches;
+
+	/** Sequence of the last input consumed */
+	uint32 LastInputSequence = 0;
+
+	/** Physics simulation time at the end of the last step */
+	double SimTime = 0.0;
+
+public:
+
+	/** Name used for the callback's stats */
+	virtual FName GetFNameForStatId() const override;
+
+protected:
+
+	/** Integrates every batch by the fixed physics delta time */
+	virtual void OnPreSimulate_Internal() override;
+
+	/** Applies the corrections of a new input, then moves its launches and class settings into the batches */
+	void ConsumeInput(const FShooterProjectileAsyncInput& Input, FShooterProjectileAsyncOutput& Output);
+
+	/** Advances a batch in fixed sub-steps, reporting the segment of every projectile that moved */
+	void AdvanceBatch(FShooterProjectileBatch& Batch, float DeltaTime, FShooterProjectileAsyncOutput& Output) const;
+};
@@ -0,0 +1,192 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterProjectilePool.h"
+#include "ShooterProjectile.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "SimpleShooter.h"
+
+static FAutoConsoleCommandWithWorld CVarShooterProjectilePoolStats(
+	TEXT("Shooter.ProjectilePool.Stats"),
+	TEXT("Logs the hit, miss and high-water mark counters of every projectile pool in the world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UShooterProjectilePool* Pool = World ? World->GetSubsystem<UShooterProjectilePool>() : nullptr)
+		{
+			Pool->LogStats();
+		}
+	})
+);
+
+bool UShooterProjectilePool::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterProjectilePool::Deinitialize()
+{
+	LogStats();
+
+	Buckets.Empty();
+
+	Super::Deinitialize();
+}
+
+void UShooterProjectilePool::Prewarm(TSubclassOf<AShooterProjectile> ProjectileClass, int32 Count)
+{
+	if (!ProjectileClass)
+	{
+		return;
+	}
+
+	FShooterProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass);
+
+	// spawn idle projectiles until we reach the requested count
+	while (Bucket.Stats.TotalSpawned < Count)
+	{
+		if (AShooterProjectile* Projectile = SpawnPooledProjectile(ProjectileClass, FTransform::Identity, nullptr, nullptr))
+		{
+			// park it right away. It was never handed out, so it doesn't count as in use
+			Projectile->OnReleasedToPool();
+			Bucket.IdleProjectiles.Add(Projectile);
+
+		} else {
+
+			// spawning failed, don't keep trying
+			break;
+		}
+	}
+}
+
+AShooterProjectile* UShooterProjectilePool::AcquireProjectile(TSubclassOf<AShooterProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator)
+{
+	if (!ProjectileClass)
+	{
+		return nullptr;
+	}
+
+	FShooterProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass);
+
+	AShooterProjectile* Projectile = nullptr;
+
+	// reuse an idle projectile if we have one. Skip any that were destroyed behind our back
+	while (!Projectile && Bucket.IdleProjectiles.Num() > 0)
+	{
+		AShooterProjectile* Candidate = Bucket.IdleProjectiles.Pop(EAllowShrinking::No);
+
+		if (IsValid(Candidate))
+		{
+			Projectile = Candidate;
+
+		} else {
+
+			--Bucket.Stats.TotalSpawned;
+		}
+	}
+
+	if (Projectile)
+	{
+		++Bucket.Stats.Hits;
+
+		// reset the projectile to its spawn state
+		Projectile->OnAcquiredFromPool(SpawnTransform, NewOwner, NewInstigator);
+
+	} else {
+
+		++Bucket.Stats.Misses;
+
+		// the pool is dry, so spawn a new one. It starts out ready to fly
+		Projectile = SpawnPooledProjectile(ProjectileClass, SpawnTransform, NewOwner, NewInstigator);
+
+		if (!Projectile)
+		{
+			return nullptr;
+		}
+	}
+
+	// update the usage counters
+	++Bucket.Stats.InUse;
+	Bucket.Stats.HighWaterMark = FMath::Max(Bucket.Stats.HighWaterMark, Bucket.Stats.InUse);
+
+	return Projectile;
+}
+
+void UShooterProjectilePool::ReleaseProjectile(AShooterProjectile* Projectile)
+{
+	if (!IsValid(Projectile) || Projectile->IsInPool())
+	{
+		return;
+	}
+
+	FShooterProjectilePoolBucket* Bucket = Buckets.Find(Projectile->GetClass());
+
+	if (!Bucket)
+	{
+		// this projectile doesn't belong to the pool
+		Projectile->Destroy();
+		return;
+	}
+
+	// park the projectile
+	Projectile->OnReleasedToPool();
+	Bucket->IdleProjectiles.Add(Projectile);
+
+	--Bucket->Stats.InUse;
+}
+
+void UShooterProjectilePool::NotifyProjectileDestroyed(AShooterProjectile* Projectile)
+{
+	if (FShooterProjectilePoolBucket* Bucket = Buckets.Find(Projectile->GetClass()))
+	{
+		// idle projectiles are pruned lazily on acquire, so only account for the ones in flight here
+		if (!Projectile->IsInPool())
+		{
+			--Bucket->Stats.InUse;
+			--Bucket->Stats.TotalSpawned;
+		}
+	}
+}
+
+const FShooterProjectilePoolStats* UShooterProjectilePool::GetStats(TSubclassOf<AShooterProjectile> ProjectileClass) const
+{
+	const FShooterProjectilePoolBucket* Bucket = Buckets.Find(ProjectileClass);
+	return Bucket ? &Bucket->Stats : nullptr;
+}
+
+void UShooterProjectilePool::LogStats() const
+{
+	for (const TPair<TSubclassOf<AShooterProjectile>, FShooterProjectilePoolBucket>& Pair : Buckets)
+	{
+		const FShooterProjectilePoolStats& Stats = Pair.Value.Stats;
+
+		UE_LOG(LogSimpleShooter, Log, TEXT("Projectile pool [%s]: hits %d, misses %d, in use %d, high-water mark %d, total %d"),
+			*GetNameSafe(Pair.Key), Stats.Hits, Stats.Misses, Stats.InUse, Stats.HighWaterMark, Stats.TotalSpawned);
+	}
+}
+
+AShooterProjectile* UShooterProjectilePool::SpawnPooledProjectile(TSubclassOf<AShooterProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator)
+{
+	// defer the spawn so the projectile knows it's pooled before it begins play
+	AShooterProjectile* Projectile = GetWorld()->SpawnActorDeferred<AShooterProjectile>(ProjectileClass, SpawnTransform, NewOwner, NewInstigator, ESpawnActorCollisionHandlingMethod::AlwaysSpawn, ESpawnActorScaleMethod::OverrideRootScale);
+
+	if (!Projectile)
+	{
+		return nullptr;
+	}
+
+	Projectile->SetPool(this);
+
+	// projectiles replicated through spawn records, and anything spawned on a client, only exist locally
+	if (Projectile->ReplicatesSpawnOnly() || GetWorld()->GetNetMode() == NM_Client)
+	{
+		Projectile->SetReplicates(false);
+	}
+
+	Projectile->FinishSpawning(SpawnTransform);
+
+	++Buckets.FindOrAdd(ProjectileClass).Stats.TotalSpawned;
+
+	return Projectile;
+}
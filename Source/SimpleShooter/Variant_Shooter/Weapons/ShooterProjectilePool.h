@@ -0,0 +1,104 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterProjectilePool.generated.h"
+
+class AShooterProjectile;
+class APawn;
+
+/**
+ *  Usage counters for a single projectile class pool
+ */
+USTRUCT(BlueprintType)
+struct FShooterProjectilePoolStats
+{
+	GENERATED_BODY()
+
+	/** Number of requests served from an idle pooled projectile */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 Hits = 0;
+
+	/** Number of requests that had to spawn a new projectile */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 Misses = 0;
+
+	/** Number of projectiles currently handed out */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 InUse = 0;
+
+	/** Highest number of projectiles handed out at the same time */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 HighWaterMark = 0;
+
+	/** Total number of projectiles owned by the pool, idle or in use */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 TotalSpawned = 0;
+};
+
+/**
+ *  Idle projectiles and counters for a single projectile class
+ */
+USTRUCT()
+struct FShooterProjectilePoolBucket
+{
+	GENERATED_BODY()
+
+	/** Projectiles ready to be handed out */
+	UPROPERTY()
+	TArray<TObjectPtr<AShooterProjectile>> IdleProjectiles;
+
+	/** Usage counters */
+	UPROPERTY()
+	FShooterProjectilePoolStats Stats;
+};
+
+/**
+ *  Per-world pool of projectile actors, keyed by projectile class
+ *  Hands out projectiles reset to their spawn state and takes them back after they're done,
+ *  so sustained fire doesn't pay for actor construction, component registration and GC churn
+ */
+UCLASS()
+class SIMPLESHOOTER_API UShooterProjectilePool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Pooled projectiles, keyed by class */
+	UPROPERTY()
+	TMap<TSubclassOf<AShooterProjectile>, FShooterProjectilePoolBucket> Buckets;
+
+protected:
+
+	/** Only create the pool for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Spawns idle projectiles of the given class until the pool holds at least Count of them */
+	void Prewarm(TSubclassOf<AShooterProjectile> ProjectileClass, int32 Count);
+
+	/** Hands out a projectile of the given class, placed at the given transform and ready to fly */
+	AShooterProjectile* AcquireProjectile(TSubclassOf<AShooterProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator);
+
+	/** Takes a projectile back into the pool */
+	void ReleaseProjectile(AShooterProjectile* Projectile);
+
+	/** Called by pooled projectiles that get destroyed while handed out */
+	void NotifyProjectileDestroyed(AShooterProjectile* Projectile);
+
+	/** Returns the usage counters for the given class, or nullptr if it was never pooled */
+	const FShooterProjectilePoolStats* GetStats(TSubclassOf<AShooterProjectile> ProjectileClass) const;
+
+	/** Writes the usage counters of all pools to the log */
+	void LogStats() const;
+
+protected:
+
+	/** Spawns a new pooled projectile of the given class */
+	AShooterProjectile* SpawnPooledProjectile(TSubclassOf<AShooterProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator);
+};
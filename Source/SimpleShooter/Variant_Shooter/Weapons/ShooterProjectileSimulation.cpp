@@ -0,0 +1,601 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterProjectileSimulation.h"
+#include "ShooterProjectile.h"
+#include "ShooterWeapon.h"
+#include "ShooterImpactEffects.h"
+#include "Components/SphereComponent.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/WorldSettings.h"
+#include "Engine/World.h"
+#include "Async/ParallelFor.h"
+#include "ShooterProjectileAsyncCallback.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "PBDRigidsSolver.h"
+#include "SimpleShooter.h"
+
+/** Lifetime for simulated projectiles whose class doesn't set an initial life span */
+static constexpr float DefaultSimulatedProjectileLifetime = 10.0f;
+
+/** Shortest sub-step simulated projectiles can use, to keep the step count sane */
+static constexpr float MinSimulatedProjectileStepTime = 0.001f;
+
+FShooterProjectileStepSettings FShooterProjectileStepSettings::Make(const AShooterProjectile* Settings, const UWorld* World)
+{
+	const UProjectileMovementComponent* Movement = Settings->GetProjectileMovement();
+	const USphereComponent* Collision = Settings->GetCollisionComponent();
+
+	FShooterProjectileStepSettings StepSettings;
+	StepSettings.Gravity = FVector(0.0f, 0.0f, World->GetGravityZ() * Movement->ProjectileGravityScale);
+	StepSettings.MaxSpeed = Movement->GetMaxSpeed();
+	StepSettings.Radius = Collision->GetUnscaledSphereRadius();
+	StepSettings.Channel = Collision->GetCollisionObjectType();
+	StepSettings.ResponseParams = FCollisionResponseParams(Collision->GetCollisionResponseToChannels());
+	StepSettings.bReturnPhysicalMaterial = Collision->bReturnMaterialOnMove && !IsRunningDedicatedServer();
+	StepSettings.Lifetime = Settings->InitialLifeSpan > 0.0f ? Settings->InitialLifeSpan : DefaultSimulatedProjectileLifetime;
+	StepSettings.KillZ = World->GetWorldSettings()->KillZ;
+	StepSettings.MaxBounces = Settings->GetMaxBounces();
+	StepSettings.Friction = Movement->Friction;
+	StepSettings.Bounciness = Movement->Bounciness;
+	StepSettings.StepTime = FMath::Max(Movement->MaxSimulationTimeStep, MinSimulatedProjectileStepTime);
+	StepSettings.MaxSteps = FMath::Max(Movement->MaxSimulationIterations, 1);
+
+	return StepSettings;
+}
+
+void FShooterProjectileBatch::Add(const FVector& Position, const FVector& Velocity, const TWeakObjectPtr<APawn>& Owner, uint32 OwnerId, const TWeakObjectPtr<AActor>& DamageCauser, float Damage, uint16 ShotId, float TimeSinceShot, uint32 ProjectileId)
+{
+	Positions.Add(Position);
+	Velocities.Add(Velocity);
+	Owners.Add(Owner);
+	OwnerIds.Add(OwnerId);
+	DamageCausers.Add(DamageCauser);
+	Damages.Add(Damage);
+	ShotIds.Add(ShotId);
+	BounceCounts.Add(0);
+	Ages.Add(0.0f);
+	PendingTimes.Add(TimeSinceShot);
+	ProjectileIds.Add(ProjectileId);
+
+	// keep the scratch arrays in step so a projectile added mid-resolve doesn't shift indices
+	EndPositions.Add(Position);
+	EndVelocities.Add(Velocity);
+	Hits.AddDefaulted();
+}
+
+void FShooterProjectileBatch::RemoveAtSwap(int32 Index)
+{
+	Positions.RemoveAtSwap(Index, EAllowShrinking::No);
+	Velocities.RemoveAtSwap(Index, EAllowShrinking::No);
+	Owners.RemoveAtSwap(Index, EAllowShrinking::No);
+	OwnerIds.RemoveAtSwap(Index, EAllowShrinking::No);
+	DamageCausers.RemoveAtSwap(Index, EAllowShrinking::No);
+	Damages.RemoveAtSwap(Index, EAllowShrinking::No);
+	ShotIds.RemoveAtSwap(Index, EAllowShrinking::No);
+	BounceCounts.RemoveAtSwap(Index, EAllowShrinking::No);
+	Ages.RemoveAtSwap(Index, EAllowShrinking::No);
+	PendingTimes.RemoveAtSwap(Index, EAllowShrinking::No);
+	ProjectileIds.RemoveAtSwap(Index, EAllowShrinking::No);
+	EndPositions.RemoveAtSwap(Index, EAllowShrinking::No);
+	EndVelocities.RemoveAtSwap(Index, EAllowShrinking::No);
+	Hits.RemoveAtSwap(Index, EAllowShrinking::No);
+}
+
+bool UShooterProjectileSimulation::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterProjectileSimulation::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// the physics thread simulation only makes sense with a fixed async physics step
+	if (!UPhysicsSettings::Get()->bTickPhysicsAsync)
+	{
+		return;
+	}
+
+	if (FPhysScene* PhysScene = InWorld.GetPhysicsScene())
+	{
+		AsyncCallback = PhysScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FShooterProjectileAsyncCallback>();
+	}
+}
+
+void UShooterProjectileSimulation::Deinitialize()
+{
+	// hand the physics thread simulation back to the solver
+	if (AsyncCallback)
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(AsyncCallback);
+		}
+
+		AsyncCallback = nullptr;
+	}
+
+	AsyncStepSettings.Empty();
+	AsyncProjectiles.Empty();
+	SupersededAsyncIds.Empty();
+	Batches.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterProjectileSimulation::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterProjectileSimulation, STATGROUP_Tickables);
+}
+
+void UShooterProjectileSimulation::SpawnProjectile(TSubclassOf<AShooterProjectile> ProjectileClass, const FTransform& SpawnTransform, APawn* Owner, AActor* DamageCauser, uint16 ShotId, float TimeSinceShot)
+{
+	SpawnProjectiles(ProjectileClass, MakeArrayView(&SpawnTransform, 1), Owner, DamageCauser, ShotId, TimeSinceShot);
+}
+
+void UShooterProjectileSimulation::SpawnProjectiles(TSubclassOf<AShooterProjectile> ProjectileClass, TConstArrayView<FTransform> SpawnTransforms, APawn* Owner, AActor* DamageCauser, uint16 FirstShotId, float TimeSinceShot)
+{
+	if (!ProjectileClass)
+	{
+		return;
+	}
+
+	const AShooterProjectile* Settings = ProjectileClass->GetDefaultObject<AShooterProjectile>();
+
+	// launch along the spawn direction at the initial speed of the movement component
+	const UProjectileMovementComponent* Movement = Settings->GetProjectileMovement();
+	const float LaunchSpeed = Movement->InitialSpeed > 0.0f ? Movement->InitialSpeed : Movement->GetMaxSpeed();
+	const float Damage = Settings->GetHitDamage();
+	const uint32 OwnerId = Owner ? Owner->GetUniqueID() : 0;
+
+	// hand the projectiles over to the physics thread if this class moves there
+	if (AsyncCallback && Settings->SimulatesOnPhysicsThread())
+	{
+		FShooterProjectileAsyncInput* Input = GetAsyncInput();
+
+		if (!AsyncStepSettings.Contains(Settings))
+		{
+			const FShooterProjectileStepSettings& StepSettings = AsyncStepSettings.Add(Settings, FShooterProjectileStepSettings::Make(Settings, GetWorld()));
+			Input->NewClasses.Emplace(Settings, StepSettings);
+		}
+
+		for (int32 i = 0; i < SpawnTransforms.Num(); ++i)
+		{
+			const uint32 ProjectileId = NextAsyncProjectileId++;
+
+			// the physics thread only needs the motion. Everything needed to resolve a hit stays here
+			FShooterProjectileAsyncLaunch& Launch = Input->Launches.AddDefaulted_GetRef();
+			Launch.Settings = Settings;
+			Launch.ProjectileId = ProjectileId;
+			Launch.Position = SpawnTransforms[i].GetLocation();
+			Launch.Velocity = SpawnTransforms[i].GetRotation().GetForwardVector() * LaunchSpeed;
+			Launch.TimeSinceShot = FMath::Max(TimeSinceShot, 0.0f);
+
+			FShooterProjectileAsyncFlight& Flight = AsyncProjectiles.Add(ProjectileId);
+			Flight.Settings = Settings;
+			Flight.Owner = Owner;
+			Flight.OwnerId = OwnerId;
+			Flight.DamageCauser = DamageCauser;
+			Flight.Damage = Damage;
+			Flight.ShotId = static_cast<uint16>(FirstShotId + i);
+		}
+
+		return;
+	}
+
+	FShooterProjectileBatch& Batch = Batches.FindOrAdd(ProjectileClass);
+
+	if (!Batch.Settings)
+	{
+		Batch.Settings = Settings;
+		Batch.StepSettings = FShooterProjectileStepSettings::Make(Settings, GetWorld());
+	}
+
+	for (int32 i = 0; i < SpawnTransforms.Num(); ++i)
+	{
+		const FTransform& SpawnTransform = SpawnTransforms[i];
+		Batch.Add(SpawnTransform.GetLocation(), SpawnTransform.GetRotation().GetForwardVector() * LaunchSpeed, Owner, OwnerId, DamageCauser, Damage, static_cast<uint16>(FirstShotId + i), FMath::Max(TimeSinceShot, 0.0f));
+	}
+}
+
+int32 UShooterProjectileSimulation::GetNumProjectiles() const
+{
+	int32 Total = 0;
+
+	for (const TPair<const UClass*, FShooterProjectileBatch>& Pair : Batches)
+	{
+		Total += Pair.Value.Num();
+	}
+
+	return Total + AsyncProjectiles.Num();
+}
+
+void UShooterProjectileSimulation::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterProjectileSimulation::Tick);
+
+	// sweep whatever the physics thread moved since the last frame
+	if (AsyncCallback)
+	{
+		ResolveAsyncSteps();
+	}
+
+	for (TPair<const UClass*, FShooterProjectileBatch>& Pair : Batches)
+	{
+		FShooterProjectileBatch& Batch = Pair.Value;
+
+		if (Batch.Num() == 0)
+		{
+			continue;
+		}
+
+		StepBatch(Batch, DeltaTime, GetWorld(), [this](const FShooterProjectileBatch& HitBatch, int32 Index, const FHitResult& Hit)
+		{
+			ResolveHit(HitBatch.Settings, HitBatch.Owners[Index].Get(), HitBatch.DamageCausers[Index].Get(), HitBatch.Damages[Index], HitBatch.ShotIds[Index], Hit);
+		});
+	}
+}
+
+void UShooterProjectileSimulation::StepBatch(FShooterProjectileBatch& Batch, float DeltaTime, const UWorld* World, TFunctionRef<void(const FShooterProjectileBatch&, int32, const FHitResult&)> OnHit)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterProjectileSimulation::StepBatch);
+
+	const FShooterProjectileStepSettings& StepSettings = Batch.StepSettings;
+
+	// projectiles launched since the last step already owe the time since their shot
+	for (int32 i = 0; i < Batch.NumSettled; ++i)
+	{
+		Batch.PendingTimes[i] += DeltaTime;
+	}
+
+	// count the projectiles due a step once, then let each resolve pass keep the count
+	int32 NumDue = 0;
+
+	for (const float PendingTime : Batch.PendingTimes)
+	{
+		NumDue += PendingTime >= StepSettings.StepTime ? 1 : 0;
+	}
+
+	// pay the owed time off in fixed steps, so the same shot covers the same segments at any tick rate
+	for (int32 Step = 0; Step < StepSettings.MaxSteps && NumDue > 0; ++Step)
+	{
+		// advance, sweep and resolve the whole batch in separate passes
+		IntegrateBatch(Batch);
+		SweepBatch(Batch, World);
+		NumDue = ResolveStep(Batch, OnHit);
+	}
+
+	// don't let a long hitch snowball into more and more owed steps
+	const float MaxPendingTime = StepSettings.StepTime * StepSettings.MaxSteps;
+
+	for (float& PendingTime : Batch.PendingTimes)
+	{
+		PendingTime = FMath::Min(PendingTime, MaxPendingTime);
+	}
+
+	Batch.NumSettled = Batch.Num();
+}
+
+void UShooterProjectileSimulation::IntegrateBatch(FShooterProjectileBatch& Batch)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterProjectileSimulation::IntegrateBatch);
+
+	const FVector Gravity = Batch.StepSettings.Gravity;
+	const double FixedStepTime = Batch.StepSettings.StepTime;
+
+	// no speed limit is the same as one nothing can reach, which keeps the clamp out of a branch
+	const double MaxSpeed = Batch.StepSettings.MaxSpeed > 0.0 ? Batch.StepSettings.MaxSpeed : UE_BIG_NUMBER;
+
+	const int32 Count = Batch.Num();
+
+	const FVector* RESTRICT Positions = Batch.Positions.GetData();
+	const FVector* RESTRICT Velocities = Batch.Velocities.GetData();
+	const float* RESTRICT PendingTimes = Batch.PendingTimes.GetData();
+	FVector* RESTRICT EndPositions = Batch.EndPositions.GetData();
+	FVector* RESTRICT EndVelocities = Batch.EndVelocities.GetData();
+
+	// straight loop over contiguous arrays. The step and speed clamps are arithmetic and min, not branches, so the compiler is free to vectorize it
+	for (int32 i = 0; i < Count; ++i)
+	{
+		// projectiles owing less than a full step stay put
+		const double StepTime = FixedStepTime * static_cast<double>(PendingTimes[i] >= FixedStepTime);
+		const double HalfDeltaTime = 0.5 * StepTime;
+
+		const FVector UnclampedVelocity = Velocities[i] + Gravity * StepTime;
+
+		// scale down to the max speed. The floor on the squared size keeps a resting projectile from dividing by zero
+		const double SpeedScale = FMath::Min(1.0, MaxSpeed * FMath::InvSqrt(FMath::Max(UnclampedVelocity.SizeSquared(), UE_DOUBLE_SMALL_NUMBER)));
+		const FVector EndVelocity = UnclampedVelocity * SpeedScale;
+
+		EndVelocities[i] = EndVelocity;
+
+		// trapezoidal step is exact for constant gravity
+		EndPositions[i] = Positions[i] + (Velocities[i] + EndVelocity) * HalfDeltaTime;
+	}
+}
+
+void UShooterProjectileSimulation::SweepBatch(FShooterProjectileBatch& Batch, const UWorld* World)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterProjectileSimulation::SweepBatch);
+
+	// every projectile in the batch sweeps with the collision settings of the class defaults
+	const FShooterProjectileStepSettings& StepSettings = Batch.StepSettings;
+	const FCollisionShape SweepShape = FCollisionShape::MakeSphere(StepSettings.Radius);
+	FCollisionQueryParams BaseQueryParams(SCENE_QUERY_STAT(ShooterProjectileSweep), false);
+	BaseQueryParams.bReturnPhysicalMaterial = StepSettings.bReturnPhysicalMaterial;
+
+	// scene queries are read-only and safe to run concurrently, so sweep the whole batch in parallel
+	ParallelFor(Batch.Num(), [&](int32 i)
+	{
+		// a projectile sitting this step out would only report overlaps at its current location
+		if (Batch.GetStepTime(i) <= 0.0f)
+		{
+			Batch.Hits[i].Reset();
+			return;
+		}
+
+		FCollisionQueryParams QueryParams = BaseQueryParams;
+
+		if (Batch.OwnerIds[i] != 0)
+		{
+			QueryParams.AddIgnoredActor(Batch.OwnerIds[i]);
+		}
+
+		World->SweepSingleByChannel(Batch.Hits[i], Batch.Positions[i], Batch.EndPositions[i], FQuat::Identity, StepSettings.Channel, SweepShape, QueryParams, StepSettings.ResponseParams);
+	});
+}
+
+int32 UShooterProjectileSimulation::ResolveStep(FShooterProjectileBatch& Batch, TFunctionRef<void(const FShooterProjectileBatch&, int32, const FHitResult&)> OnHit)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterProjectileSimulation::ResolveStep);
+
+	const FShooterProjectileStepSettings& StepSettings = Batch.StepSettings;
+
+	// projectiles still owing a full step once this one is resolved
+	int32 NumDue = 0;
+
+	// walk backwards so removing with swap never skips a projectile
+	for (int32 i = Batch.Num() - 1; i >= 0; --i)
+	{
+		const float StepTime = Batch.GetStepTime(i);
+
+		if (StepTime <= 0.0f)
+		{
+			continue;
+		}
+
+		const FHitResult& Hit = Batch.Hits[i];
+
+		if (Hit.bBlockingHit)
+		{
+			// only the time up to the impact was spent. A bounce flies the rest of the step in the next sub-step
+			const float SpentTime = StepTime * Hit.Time;
+			Batch.Ages[i] += SpentTime;
+			Batch.PendingTimes[i] -= SpentTime;
+
+			if (BounceProjectile(Batch, i, Hit))
+			{
+				NumDue += Batch.PendingTimes[i] >= StepSettings.StepTime ? 1 : 0;
+				continue;
+			}
+
+			OnHit(Batch, i, Hit);
+
+			Batch.RemoveAtSwap(i);
+			continue;
+		}
+
+		// no hit, so commit the step
+		Batch.Positions[i] = Batch.EndPositions[i];
+		Batch.Velocities[i] = Batch.EndVelocities[i];
+		Batch.Ages[i] += StepTime;
+		Batch.PendingTimes[i] -= StepTime;
+
+		// retire projectiles that flew for too long or fell out of the world
+		if (Batch.Ages[i] > StepSettings.Lifetime || Batch.Positions[i].Z < StepSettings.KillZ)
+		{
+			Batch.RemoveAtSwap(i);
+			continue;
+		}
+
+		NumDue += Batch.PendingTimes[i] >= StepSettings.StepTime ? 1 : 0;
+	}
+
+	return NumDue;
+}
+
+bool UShooterProjectileSimulation::BounceProjectile(FShooterProjectileBatch& Batch, int32 Index, const FHitResult& Hit)
+{
+	const FShooterProjectileStepSettings& StepSettings = Batch.StepSettings;
+
+	// bounce off the world until we run out of bounces. Hitting a pawn always counts
+	if (Batch.BounceCounts[Index] >= StepSettings.MaxBounces || Cast<APawn>(Hit.GetActor()))
+	{
+		return false;
+	}
+
+	// velocity at the moment of impact, not at the end of the step
+	const FVector ImpactVelocity = FMath::Lerp(Batch.Velocities[Index], Batch.EndVelocities[Index], Hit.Time);
+
+	Batch.Positions[Index] = Hit.Location;
+	Batch.Velocities[Index] = GetBounceVelocity(StepSettings, ImpactVelocity, Hit.ImpactNormal);
+	++Batch.BounceCounts[Index];
+
+	return true;
+}
+
+FVector UShooterProjectileSimulation::GetBounceVelocity(const FShooterProjectileStepSettings& StepSettings, const FVector& ImpactVelocity, const FVector& ImpactNormal)
+{
+	const FVector NormalVelocity = ImpactNormal * FVector::DotProduct(ImpactVelocity, ImpactNormal);
+	const FVector TangentVelocity = ImpactVelocity - NormalVelocity;
+
+	return TangentVelocity * (1.0f - StepSettings.Friction) - NormalVelocity * StepSettings.Bounciness;
+}
+
+FShooterProjectileAsyncInput* UShooterProjectileSimulation::GetAsyncInput()
+{
+	FShooterProjectileAsyncInput* Input = AsyncCallback->GetProducerInputData_External();
+
+	// inputs are recycled, so tag fresh ones
+	if (Input->Sequence == 0)
+	{
+		Input->Sequence = ++AsyncInputSequence;
+	}
+
+	return Input;
+}
+
+void UShooterProjectileSimulation::ResolveAsyncSteps()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UShooterProjectileSimulation::ResolveAsyncSteps);
+
+	// take every step the physics thread finished, including ones ahead of the interpolated time
+	TArray<Chaos::TSimCallbackOutputHandle<FShooterProjectileAsyncOutput>, TInlineAllocator<4>> Outputs;
+
+	while (Chaos::TSimCallbackOutputHandle<FShooterProjectileAsyncOutput> Output = AsyncCallback->PopFutureOutputData_External())
+	{
+		Outputs.Emplace(MoveTemp(Output));
+	}
+
+	// flatten the segments of every step, oldest first
+	TArray<const FShooterProjectileAsyncSegment*> Segments;
+
+	for (const Chaos::TSimCallbackOutputHandle<FShooterProjectileAsyncOutput>& Output : Outputs)
+	{
+		for (const FShooterProjectileAsyncSegment& Segment : Output->Segments)
+		{
+			Segments.Add(&Segment);
+		}
+	}
+
+	AsyncHits.SetNum(Segments.Num(), EAllowShrinking::No);
+
+	// sweep every segment against the game thread scene in parallel. Nothing writes to the scene while we do
+	ParallelFor(Segments.Num(), [this, &Segments](int32 i)
+	{
+		const FShooterProjectileAsyncSegment& Segment = *Segments[i];
+		const FShooterProjectileStepSettings* StepSettings = AsyncStepSettings.Find(Segment.Settings);
+		const FShooterProjectileAsyncFlight* Flight = AsyncProjectiles.Find(Segment.ProjectileId);
+
+		AsyncHits[i].Reset();
+
+		// segments of projectiles that already hit something are thrown away anyway
+		if (!StepSettings || !Flight || SupersededAsyncIds.Contains(Segment.ProjectileId))
+		{
+			return;
+		}
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterProjectileSweep), false);
+		QueryParams.bReturnPhysicalMaterial = StepSettings->bReturnPhysicalMaterial;
+
+		if (Flight->OwnerId != 0)
+		{
+			QueryParams.AddIgnoredActor(Flight->OwnerId);
+		}
+
+		GetWorld()->SweepSingleByChannel(AsyncHits[i], Segment.Start, Segment.End, FQuat::Identity, StepSettings->Channel, FCollisionShape::MakeSphere(StepSettings->Radius), QueryParams, StepSettings->ResponseParams);
+	});
+
+	// resolve in step order, so a projectile's later segments are dropped once it hits something
+	int32 SegmentIndex = 0;
+
+	for (const Chaos::TSimCallbackOutputHandle<FShooterProjectileAsyncOutput>& Output : Outputs)
+	{
+		for (int32 i = 0; i < Output->Segments.Num(); ++i, ++SegmentIndex)
+		{
+			const FShooterProjectileAsyncSegment& Segment = Output->Segments[i];
+			const FHitResult& Hit = AsyncHits[SegmentIndex];
+
+			if (!Hit.bBlockingHit || SupersededAsyncIds.Contains(Segment.ProjectileId))
+			{
+				continue;
+			}
+
+			const FShooterProjectileAsyncFlight* FoundFlight = AsyncProjectiles.Find(Segment.ProjectileId);
+			const FShooterProjectileStepSettings* StepSettings = AsyncStepSettings.Find(Segment.Settings);
+
+			if (!FoundFlight || !StepSettings)
+			{
+				continue;
+			}
+
+			FShooterProjectileAsyncFlight Flight = *FoundFlight;
+			AsyncProjectiles.Remove(Segment.ProjectileId);
+
+			// the physics thread keeps moving the projectile until it applies the correction, so ignore it until then
+			SupersededAsyncIds.Add(Segment.ProjectileId);
+
+			FShooterProjectileAsyncCorrection& Correction = GetAsyncInput()->Corrections.AddDefaulted_GetRef();
+			Correction.Settings = Segment.Settings;
+			Correction.ProjectileId = Segment.ProjectileId;
+
+			// bounce off the world until we run out of bounces. Hitting a pawn always counts
+			if (Flight.BounceCount < StepSettings->MaxBounces && !Cast<APawn>(Hit.GetActor()))
+			{
+				const FVector ImpactVelocity = FMath::Lerp(Segment.StartVelocity, Segment.EndVelocity, Hit.Time);
+
+				// the bounced projectile carries on under a new ID, so its segments can't be confused with the old ones
+				Correction.NewProjectileId = NextAsyncProjectileId++;
+				Correction.Position = Hit.Location;
+				Correction.Velocity = GetBounceVelocity(*StepSettings, ImpactVelocity, Hit.ImpactNormal);
+				Correction.BounceCount = ++Flight.BounceCount;
+				Correction.HitTime = Segment.StartTime + Segment.StepTime * Hit.Time;
+
+				AsyncProjectiles.Add(Correction.NewProjectileId, Flight);
+				continue;
+			}
+
+			ResolveHit(Flight.Settings, Flight.Owner.Get(), Flight.DamageCauser.Get(), Flight.Damage, Flight.ShotId, Hit);
+		}
+
+		for (const uint32 RetiredId : Output->RetiredIds)
+		{
+			AsyncProjectiles.Remove(RetiredId);
+		}
+
+		// the physics thread won't report these IDs again
+		for (const uint32 CorrectedId : Output->CorrectedIds)
+		{
+			SupersededAsyncIds.Remove(CorrectedId);
+		}
+	}
+}
+
+void UShooterProjectileSimulation::ResolveHit(const AShooterProjectile* Settings, APawn* Instigator, AActor* DamageCauser, float Damage, uint16 ShotId, const FHitResult& Hit)
+{
+	// resolve the hit the same way a projectile actor does
+	FShooterProjectileImpactParams Params;
+	Params.World = GetWorld();
+	Params.Settings = Settings;
+	Params.Instigator = Instigator;
+	Params.DamageCauser = DamageCauser;
+	Params.Damage = Damage;
+	Params.bHasAuthority = GetWorld()->GetNetMode() != NM_Client;
+
+	AShooterProjectile::ReportImpactNoise(Params, Hit.Location);
+	AShooterProjectile::ResolveImpact(Params, Hit);
+
+	// batched projectiles have no actor to run Blueprint effects on, so only the response table can show them.
+	// The weapon spawns actors instead while there's no table, so a miss here means the table lacks a default row
+	if (UShooterImpactEffects* ImpactEffects = GetWorld()->GetSubsystem<UShooterImpactEffects>())
+	{
+		if (!ImpactEffects->QueueImpact(Settings->GetClass(), Hit))
+		{
+			UE_LOG(LogSimpleShooter, Verbose, TEXT("No impact response for batched projectile %s, add a default row to the response table"), *Settings->GetClass()->GetName());
+		}
+	}
+
+	// let clients simulating this shot play the impact where it actually happened
+	if (Settings->ReplicatesSpawnOnly() && Params.bHasAuthority)
+	{
+		if (AShooterWeapon* Weapon = Cast<AShooterWeapon>(DamageCauser))
+		{
+			Weapon->BroadcastProjectileImpact(ShotId, Hit);
+		}
+	}
+}
@@ -0,0 +1,260 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/HitResult.h"
+#include "CollisionQueryParams.h"
+#include "ShooterProjectileSimulation.generated.h"
+
+class AShooterProjectile;
+class APawn;
+class FShooterProjectileAsyncCallback;
+struct FShooterProjectileAsyncInput;
+
+/**
+ *  Plain copy of the tuning needed to step a batch, so it can be read off the game thread
+ */
+struct FShooterProjectileStepSettings
+{
+	/** Gravity acceleration, already scaled by the projectile gravity scale */
+	FVector Gravity = FVector::ZeroVector;
+
+	/** Max projectile speed. 0 means no limit */
+	double MaxSpeed = 0.0;
+
+	/** Radius of the swept sphere */
+	float Radius = 0.0f;
+
+	/** Channel the projectiles sweep on */
+	TEnumAsByte<ECollisionChannel> Channel = ECC_WorldDynamic;
+
+	/** Responses of the projectile collision */
+	FCollisionResponseParams ResponseParams;
+
+	/** If true, sweeps report the physical material hit, for impact effects */
+	bool bReturnPhysicalMaterial = false;
+
+	/** Time a projectile flies before it's retired */
+	float Lifetime = 0.0f;
+
+	/** Height below which projectiles are retired */
+	double KillZ = 0.0;
+
+	/** Number of times a projectile can bounce off the world before a hit counts */
+	int32 MaxBounces = 0;
+
+	/** Velocity kept along the surface on a bounce */
+	float Friction = 0.0f;
+
+	/** Velocity kept along the normal on a bounce */
+	float Bounciness = 0.0f;
+
+	/** Fixed sub-step every projectile is advanced by, so trajectories and hits don't depend on the tick rate */
+	float StepTime = 1.0f / 60.0f;
+
+	/** Max sub-steps per tick. Time owed beyond this after a hitch is carried over, up to one tick's worth */
+	int32 MaxSteps = 8;
+
+	/** Builds the step settings from the class defaults of a projectile */
+	static FShooterProjectileStepSettings Make(const AShooterProjectile* Settings, const UWorld* World);
+};
+
+/**
+ *  All in-flight projectiles of a single class, stored as parallel arrays
+ *  Index i of every array describes the same projectile
+ */
+struct FShooterProjectileBatch
+{
+	/** Class default object providing the tuning for every projectile in the batch */
+	const AShooterProjectile* Settings = nullptr;
+
+	/** Copy of the tuning used to step the batch */
+	FShooterProjectileStepSettings StepSettings;
+
+	/** Current projectile locations */
+	TArray<FVector> Positions;
+
+	/** Current projectile velocities */
+	TArray<FVector> Velocities;
+
+	/** Pawns that shot each projectile */
+	TArray<TWeakObjectPtr<APawn>> Owners;
+
+	/** Unique IDs of the owners, so sweeps can ignore them without resolving the weak pointers */
+	TArray<uint32> OwnerIds;
+
+	/** Actors reported as the damage causer, usually the firing weapon */
+	TArray<TWeakObjectPtr<AActor>> DamageCausers;
+
+	/** Damage to apply on hit */
+	TArray<float> Damages;
+
+	/** Per-weapon shot IDs, used to replicate impacts of projectiles replicated through spawn records */
+	TArray<uint16> ShotIds;
+
+	/** Number of times each projectile has bounced off the world */
+	TArray<uint8> BounceCounts;
+
+	/** Time each projectile has been flying */
+	TArray<float> Ages;
+
+	/** Simulation time each projectile still owes, paid off in fixed steps. Starts at the time since the projectile was fired */
+	TArray<float> PendingTimes;
+
+	/** IDs the game thread gave projectiles simulated on the physics thread, so its corrections can find them. 0 on the game thread */
+	TArray<uint32> ProjectileIds;
+
+	/** Number of projectiles in the batch after the last step. Any past this were launched since and only owe the time since their shot */
+	int32 NumSettled = 0;
+
+	/** Scratch: end of this step's movement segment */
+	TArray<FVector> EndPositions;
+
+	/** Scratch: end of this step's velocity */
+	TArray<FVector> EndVelocities;
+
+	/** Scratch: this step's sweep results */
+	TArray<FHitResult> Hits;
+
+	/** Returns the number of projectiles in flight */
+	int32 Num() const { return Positions.Num(); }
+
+	/** Adds a projectile to the batch */
+	void Add(const FVector& Position, const FVector& Velocity, const TWeakObjectPtr<APawn>& Owner, uint32 OwnerId, const TWeakObjectPtr<AActor>& DamageCauser, float Damage, uint16 ShotId, float TimeSinceShot, uint32 ProjectileId = 0);
+
+	/** Removes a projectile from the batch. Does not preserve order */
+	void RemoveAtSwap(int32 Index);
+
+	/** Returns the time the given projectile covers in the current sub-step. Projectiles owing less than a full step wait for the next frame */
+	float GetStepTime(int32 Index) const { return PendingTimes[Index] >= StepSettings.StepTime ? StepSettings.StepTime : 0.0f; };
+};
+
+/**
+ *  Game thread record of a projectile moved on the physics thread
+ */
+struct FShooterProjectileAsyncFlight
+{
+	/** Class defaults of the projectile */
+	const AShooterProjectile* Settings = nullptr;
+
+	/** Pawn that shot the projectile */
+	TWeakObjectPtr<APawn> Owner;
+
+	/** Unique ID of the owner, ignored by the sweeps */
+	uint32 OwnerId = 0;
+
+	/** Actor reported as the damage causer */
+	TWeakObjectPtr<AActor> DamageCauser;
+
+	/** Damage to apply on hit */
+	float Damage = 0.0f;
+
+	/** Per-weapon shot ID */
+	uint16 ShotId = 0;
+
+	/** Number of times the projectile has bounced off the world */
+	uint8 BounceCount = 0;
+};
+
+/**
+ *  Simulates projectiles without spawning an actor per shot
+ *  Projectiles are kept in structure-of-arrays batches per class, advanced in one tight loop per tick
+ *  and swept against the world as a parallel batch. Hits resolve through the same damage,
+ *  noise and explosion code as AShooterProjectile.
+ *  Classes can opt into integrating on the async physics thread instead. The physics thread only moves them and hands
+ *  each step's movement segments back here, where they're swept against the world and resolved. Bounces and hits are
+ *  sent back to the physics thread as corrections
+ */
+UCLASS()
+class SIMPLESHOOTER_API UShooterProjectileSimulation : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Batches of in-flight projectiles, one per class */
+	TMap<const UClass*, FShooterProjectileBatch> Batches;
+
+	/** Physics thread simulation, if async physics ticking is enabled */
+	FShooterProjectileAsyncCallback* AsyncCallback = nullptr;
+
+	/** Step settings of the classes the physics thread simulation has received, by class defaults */
+	TMap<const AShooterProjectile*, FShooterProjectileStepSettings> AsyncStepSettings;
+
+	/** Projectiles in flight on the physics thread, by projectile ID, with what's needed to sweep and resolve them here */
+	TMap<uint32, FShooterProjectileAsyncFlight> AsyncProjectiles;
+
+	/** IDs of physics thread projectiles that hit something, whose segments are ignored until the physics thread applies the correction */
+	TSet<uint32> SupersededAsyncIds;
+
+	/** ID to give the next projectile handed to the physics thread */
+	uint32 NextAsyncProjectileId = 1;
+
+	/** Scratch: sweep results of the physics thread segments */
+	TArray<FHitResult> AsyncHits;
+
+	/** Sequence given to the last input sent to the physics thread */
+	uint32 AsyncInputSequence = 0;
+
+	friend class FShooterProjectileAsyncCallback;
+
+protected:
+
+	/** Only create the simulation for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Registers the physics thread simulation once the physics scene is up */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Advances all projectiles */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns the stat ID for tick profiling */
+	virtual TStatId GetStatId() const override;
+
+	/** Adds a projectile of the given class, fired along the forward vector of the spawn transform */
+	void SpawnProjectile(TSubclassOf<AShooterProjectile> ProjectileClass, const FTransform& SpawnTransform, APawn* Owner, AActor* DamageCauser, uint16 ShotId = 0, float TimeSinceShot = 0.0f);
+
+	/** Adds several projectiles of the given class in one insert, such as the pellets of a shotgun shot. Shot IDs are assigned in order starting at FirstShotId */
+	void SpawnProjectiles(TSubclassOf<AShooterProjectile> ProjectileClass, TConstArrayView<FTransform> SpawnTransforms, APawn* Owner, AActor* DamageCauser, uint16 FirstShotId = 0, float TimeSinceShot = 0.0f);
+
+	/** Returns the total number of projectiles in flight */
+	int32 GetNumProjectiles() const;
+
+	/**
+	 *  Advances a batch by the given time in fixed sub-steps, sweeping the exact segment of each one and bouncing within the step
+	 *  Hits that end a projectile are passed to OnHit before it's removed. Game thread only, since it runs scene queries
+	 */
+	static void StepBatch(FShooterProjectileBatch& Batch, float DeltaTime, const UWorld* World, TFunctionRef<void(const FShooterProjectileBatch&, int32, const FHitResult&)> OnHit);
+
+protected:
+
+	/** Integrates the projectiles due a sub-step and stores the movement segment in the scratch arrays */
+	static void IntegrateBatch(FShooterProjectileBatch& Batch);
+
+	/** Sweeps every movement segment of the sub-step against the world */
+	static void SweepBatch(FShooterProjectileBatch& Batch, const UWorld* World);
+
+	/** Applies the sweep results of a sub-step: bounces, dispatches hits and retires projectiles. Returns the number still due a full step */
+	static int32 ResolveStep(FShooterProjectileBatch& Batch, TFunctionRef<void(const FShooterProjectileBatch&, int32, const FHitResult&)> OnHit);
+
+	/** Bounces a projectile off the given hit if it has bounces left. Returns true if it bounced */
+	static bool BounceProjectile(FShooterProjectileBatch& Batch, int32 Index, const FHitResult& Hit);
+
+	/** Returns the velocity a projectile leaves a surface with */
+	static FVector GetBounceVelocity(const FShooterProjectileStepSettings& StepSettings, const FVector& ImpactVelocity, const FVector& ImpactNormal);
+
+	/** Returns the input for the next physics step, tagging it if it's fresh */
+	FShooterProjectileAsyncInput* GetAsyncInput();
+
+	/** Sweeps the movement segments marshalled back from the physics thread, resolves their hits and sends back the corrections */
+	void ResolveAsyncSteps();
+
+	/** Resolves a projectile hit the same way a projectile actor does */
+	void ResolveHit(const AShooterProjectile* Settings, APawn* Instigator, AActor* DamageCauser, float Damage, uint16 ShotId, const FHitResult& Hit);
+};
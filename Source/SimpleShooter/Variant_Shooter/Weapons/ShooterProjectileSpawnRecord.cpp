@@ -0,0 +1,20 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterProjectileSpawnRecord.h"
+
+bool FShooterProjectileSpawnRecord::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	// origin to 0.1cm, direction to 16 bits per component
+	bOutSuccess &= SerializePackedVector<10, 24>(Origin, Ar);
+	bOutSuccess &= SerializeFixedVector<1, 16>(Direction, Ar);
+
+	Ar << Speed;
+	Ar << ClassIndex;
+	Ar << ServerTime;
+	Ar << ShotId;
+
+	return true;
+}
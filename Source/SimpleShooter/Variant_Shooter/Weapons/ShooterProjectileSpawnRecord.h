@@ -0,0 +1,77 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "ShooterProjectileSpawnRecord.generated.h"
+
+/** Class index meaning "the projectile class of the weapon sending the record" */
+static constexpr uint8 ShooterProjectileClassIndexNone = MAX_uint8;
+
+/**
+ *  Compact description of a projectile launch, replicated instead of the projectile actor
+ *  Clients rebuild and simulate the flight locally from it
+ */
+USTRUCT()
+struct FShooterProjectileSpawnRecord
+{
+	GENERATED_BODY()
+
+	/** Launch location */
+	UPROPERTY()
+	FVector Origin = FVector::ZeroVector;
+
+	/** Launch direction, unit length */
+	UPROPERTY()
+	FVector Direction = FVector::ForwardVector;
+
+	/** Launch speed, in cm/s */
+	UPROPERTY()
+	uint16 Speed = 0;
+
+	/** Index of the projectile class in the game state projectile class registry */
+	UPROPERTY()
+	uint8 ClassIndex = ShooterProjectileClassIndexNone;
+
+	/** Server world time of the launch */
+	UPROPERTY()
+	float ServerTime = 0.0f;
+
+	/** Per-weapon shot counter, used to match the authoritative impact to the simulated projectile */
+	UPROPERTY()
+	uint16 ShotId = 0;
+
+	/** Quantizes the record to roughly two dozen bytes */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterProjectileSpawnRecord> : public TStructOpsTypeTraitsBase2<FShooterProjectileSpawnRecord>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/**
+ *  Authoritative impact of a projectile replicated with a spawn record
+ */
+USTRUCT()
+struct FShooterProjectileImpactRecord
+{
+	GENERATED_BODY()
+
+	/** Shot the impact belongs to */
+	UPROPERTY()
+	uint16 ShotId = 0;
+
+	/** Impact location */
+	UPROPERTY()
+	FVector_NetQuantize10 Location = FVector::ZeroVector;
+
+	/** Impact surface normal */
+	UPROPERTY()
+	FVector_NetQuantizeNormal Normal = FVector::UpVector;
+};
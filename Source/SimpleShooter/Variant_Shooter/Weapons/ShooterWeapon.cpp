@@ -5,18 +5,51 @@
 #include "Kismet/KismetMathLibrary.h"
 #include "Engine/World.h"
 #include "ShooterProjectile.h"
+#include "ShooterProjectilePool.h"
+#include "ShooterProjectileSimulation.h"
+#include "ShooterLagCompensation.h"
+#include "ShooterImpactEffects.h"
 #include "ShooterWeaponHolder.h"
 #include "Components/SceneComponent.h"
 #include "TimerManager.h"
 #include "Animation/AnimInstance.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Components/SphereComponent.h"
 #include "GameFramework/Pawn.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "Engine/GameInstance.h"
+#include "ShooterGameState.h"
+#include "ShooterGameMode.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "SimpleShooter.h"
 #include <Net/UnrealNetwork.h>
 
+static FAutoConsoleCommandWithWorld CVarShooterPredictionStats(
+	TEXT("Shooter.Prediction.Stats"),
+	TEXT("Logs how many predicted shots of every weapon in the world were confirmed, corrected, unmatched or timed out"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		for (TActorIterator<AShooterWeapon> It(World); It; ++It)
+		{
+			It->LogPredictionStats();
+		}
+	})
+);
+
+/** Longest flight time a client will fast-forward a projectile rebuilt from a spawn record */
+static constexpr float MaxSpawnRecordCatchUpTime = 0.5f;
+
+/** Number of simulated shots to track before pruning finished ones */
+static constexpr int32 SimulatedProjectilePruneThreshold = 64;
+
 AShooterWeapon::AShooterWeapon()
 {
 	bReplicates = true;
-	SetReplicateMovement(true);
+
+	// the weapon attaches itself to its owner on every machine, so there's no movement to replicate
+	SetReplicateMovement(false);
 
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -44,6 +77,25 @@ void AShooterWeapon::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// look up the compiled stats the fire path reads from
+	if (UShooterWeaponStats* WeaponStats = GetGameInstance()->GetSubsystem<UShooterWeaponStats>())
+	{
+		WeaponId = WeaponStats->RegisterWeaponClass(GetClass());
+		Stats = WeaponStats->GetStats(WeaponId);
+
+		// only IDs from the weapon table mean the same thing on the other end of the connection
+		NetWeaponId = WeaponStats->IsNetworkedWeaponId(WeaponId) ? WeaponId : ShooterWeaponIdNone;
+	}
+
+	// out of weapon IDs, so keep a private copy instead
+	if (!Stats)
+	{
+		LocalStats = MakeUnique<FShooterWeaponStatBlock>();
+		GetClass()->GetDefaultObject<AShooterWeapon>()->CompileStats(*LocalStats);
+
+		Stats = LocalStats.Get();
+	}
+
 	// subscribe to the owner's destroyed delegate
 	GetOwner()->OnDestroyed.AddDynamic(this, &AShooterWeapon::OnOwnerDestroyed);
 
@@ -51,8 +103,23 @@ void AShooterWeapon::BeginPlay()
 	WeaponOwner = Cast<IShooterWeaponHolder>(GetOwner());
 	PawnOwner = Cast<APawn>(GetOwner());
 
+	// derive the seed every shot's random draws come from, in spawn order. Clients receive it with the initial replication
+	if (HasAuthority())
+	{
+		if (AShooterGameMode* GameMode = GetWorld()->GetAuthGameMode<AShooterGameMode>())
+		{
+			WeaponSeed = GameMode->MakeRandomSeed();
+
+		} else {
+
+			WeaponSeed = static_cast<int32>(GetTypeHash(GetFName()));
+		}
+	}
+
 	// fill the first ammo clip
-	CurrentBullets = MagazineSize;
+	CurrentBullets = Stats->MagazineSize;
+	BulletHistory[0] = CurrentBullets;
+	UpdateNetState();
 
 	// attach the meshes to the owner
 	WeaponOwner->AttachWeaponMeshes(this);
@@ -64,6 +131,12 @@ void AShooterWeapon::EndPlay(EEndPlayReason::Type EndPlayReason)
 
 	// clear the refire timer
 	GetWorld()->GetTimerManager().ClearTimer(RefireTimer);
+
+	// report how the predictions went
+	if (PredictionStats.Predicted > 0 || PredictionStats.AmmoCorrections > 0)
+	{
+		LogPredictionStats();
+	}
 }
 
 void AShooterWeapon::OnOwnerDestroyed(AActor* DestroyedActor)
@@ -97,22 +170,24 @@ void AShooterWeapon::StartFiring()
 {
 	// raise the firing flag
 	bIsFiring = true;
+	UpdateNetState();
 
 	// check how much time has passed since we last shot
 	// this may be under the refire rate if the weapon shoots slow enough and the player is spamming the trigger
 	const float TimeSinceLastShot = GetWorld()->GetTimeSeconds() - TimeOfLastShot;
 
-	if (TimeSinceLastShot > RefireRate)
+	if (TimeSinceLastShot > Stats->RefireRate)
 	{
 		// fire the weapon right away
 		Fire();
 
 	} else {
 
-		// if we're full auto, schedule the next shot
-		if (bFullAuto)
+		// if we're full auto, the tick fires the next shot once the refire rate has passed
+		if (Stats->bFullAuto)
 		{
-			GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::Fire, TimeSinceLastShot, false);
+			NextShotTime = TimeOfLastShot + Stats->RefireRate;
+			SampleAim(WeaponOwner->GetWeaponTargetLocation(), GetMuzzleLocation());
 		}
 
 	}
@@ -122,6 +197,7 @@ void AShooterWeapon::StopFiring()
 {
 	// lower the firing flag
 	bIsFiring = false;
+	UpdateNetState();
 
 	// clear the refire timer
 	GetWorld()->GetTimerManager().ClearTimer(RefireTimer);
@@ -135,26 +211,93 @@ void AShooterWeapon::Fire()
 		return;
 	}
 	
-	// fire a projectile at the target
-	FireProjectile(WeaponOwner->GetWeaponTargetLocation());
+	const FVector TargetLocation = WeaponOwner->GetWeaponTargetLocation();
+	const FVector MuzzleLocation = GetMuzzleLocation();
 
-	// update the time of our last shot
-	TimeOfLastShot = GetWorld()->GetTimeSeconds();
-
-	// make noise so the AI perception system can hear us
-	MakeNoise(ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
+	// fire a shot at the target
+	FireShot(TargetLocation, MuzzleLocation, 0.0f);
 
 	// are we full auto?
-	if (bFullAuto)
+	if (Stats->bFullAuto)
 	{
-		// schedule the next shot
-		GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::Fire, RefireRate, false);
+		// the tick fires the following shots, so remember where we aimed from
+		NextShotTime = TimeOfLastShot + Stats->RefireRate;
+		SampleAim(TargetLocation, MuzzleLocation);
+
 	} else {
 
 		// for semi-auto weapons, schedule the cooldown notification
-		GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::FireCooldownExpired, RefireRate, false);
+		GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::FireCooldownExpired, Stats->RefireRate, false);
+
+	}
+}
+
+void AShooterWeapon::FireShot(const FVector& TargetLocation, const FVector& MuzzleLocation, float TimeSinceShot)
+{
+	// fire a projectile at the target
+	FireProjectile(TargetLocation, MuzzleLocation, TimeSinceShot);
+
+	// update the time of our last shot
+	TimeOfLastShot = GetWorld()->GetTimeSeconds() - TimeSinceShot;
+
+	// make noise so the AI perception system can hear us. Perception only runs on the server
+	if (HasAuthority())
+	{
+		MakeNoise(Stats->ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), Stats->ShotNoiseRange, ShotNoiseTag);
+	}
+}
+
+void AShooterWeapon::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bIsFiring && Stats->bFullAuto)
+	{
+		FireOwedShots();
+	}
+}
+
+void AShooterWeapon::FireOwedShots()
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	if (NextShotTime > Now)
+	{
+		return;
+	}
 
+	const FVector TargetLocation = WeaponOwner->GetWeaponTargetLocation();
+	const FVector MuzzleLocation = GetMuzzleLocation();
+
+	// guard against a zero refire rate spinning forever
+	const float ShotInterval = FMath::Max(Stats->RefireRate, UE_KINDA_SMALL_NUMBER);
+	const float FrameLength = Now - PreviousAimTime;
+
+	int32 ShotsFired = 0;
+
+	// fire every shot that came due since the last frame, each at its own point in time
+	while (bIsFiring && NextShotTime <= Now && ShotsFired < Stats->MaxShotsPerFrame)
+	{
+		// place the shot between last frame's aim and this frame's
+		const float Alpha = FrameLength > UE_KINDA_SMALL_NUMBER ? FMath::Clamp((NextShotTime - PreviousAimTime) / FrameLength, 0.0f, 1.0f) : 1.0f;
+
+		FireShot(FMath::Lerp(PreviousTargetLocation, TargetLocation, Alpha), FMath::Lerp(PreviousMuzzleLocation, MuzzleLocation, Alpha), Now - NextShotTime);
+
+		NextShotTime += ShotInterval;
+		++ShotsFired;
 	}
+
+	// drop whatever is still owed after a hitch instead of bursting it out next frame
+	NextShotTime = FMath::Max(NextShotTime, Now);
+
+	SampleAim(TargetLocation, MuzzleLocation);
+}
+
+void AShooterWeapon::SampleAim(const FVector& TargetLocation, const FVector& MuzzleLocation)
+{
+	PreviousTargetLocation = TargetLocation;
+	PreviousMuzzleLocation = MuzzleLocation;
+	PreviousAimTime = GetWorld()->GetTimeSeconds();
 }
 
 void AShooterWeapon::FireCooldownExpired()
@@ -163,54 +306,778 @@ void AShooterWeapon::FireCooldownExpired()
 	WeaponOwner->OnSemiWeaponRefire();
 }
 
-void AShooterWeapon::FireProjectile(const FVector& TargetLocation)
+void AShooterWeapon::FireProjectile(const FVector& TargetLocation, const FVector& MuzzleLocation, float TimeSinceShot)
 {
+	// reserve the shot's IDs up front, since the first one seeds the shot's random draws. Hitscan pellets share a single ID
+	const uint16 ShotId = NextShotId;
+	NextShotId += Stats->bHitscan ? 1 : Stats->PelletCount;
+
 	// get the projectile transform
-	FTransform ProjectileTransform = CalculateProjectileSpawnTransform(TargetLocation);
-	
-	// spawn the projectile
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-	SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::OverrideRootScale;
-	SpawnParams.Owner = GetOwner();
-	SpawnParams.Instigator = PawnOwner;
+	FTransform ProjectileTransform = CalculateProjectileSpawnTransform(TargetLocation, MuzzleLocation, ShotId);
 
-	AShooterProjectile* Projectile = GetWorld()->SpawnActor<AShooterProjectile>(ProjectileClass, ProjectileTransform, SpawnParams);
+	// owning clients that can't predict the shot itself still run the ammo and refire state. The server fires the real shot
+	if (HasAuthority() || CanPredictProjectiles())
+	{
+		if (Stats->bHitscan)
+		{
+			// resolve the shot with a trace
+			FireHitscan(ProjectileTransform, ShotId);
+
+		} else {
+
+			// launch the projectile, caught up to the time it was fired at
+			SpawnProjectile(ProjectileTransform, ShotId, TimeSinceShot);
+		}
+	}
 
 	// play the firing montage
 	WeaponOwner->PlayFiringMontage(FiringMontage);
 
 	// add recoil
-	WeaponOwner->AddWeaponRecoil(FiringRecoil);
+	WeaponOwner->AddWeaponRecoil(Stats->FiringRecoil);
+
+	// consume bullets, reloading if the clip is depleted
+	bool bReloaded = false;
+
+	CurrentBullets = GetBulletsAfterShots(CurrentBullets, 1, &bReloaded);
+	++FireSequence;
 
-	// consume bullets
-	--CurrentBullets;
+	// remember the count so a late client report about this shot can still be checked
+	BulletHistory[FireSequence % ShooterAmmoHistorySize] = CurrentBullets;
 
-	// if the clip is depleted, reload it
-	if (CurrentBullets <= 0)
+	UpdateNetState(bReloaded);
+
+	// update the weapon HUD
+	WeaponOwner->UpdateWeaponHUD(CurrentBullets, Stats->MagazineSize);
+}
+
+void AShooterWeapon::FireHitscan(const FTransform& ShotTransform, uint16 ShotId)
+{
+	if (!ProjectileClass)
 	{
-		CurrentBullets = MagazineSize;
+		return;
 	}
 
-	// update the weapon HUD
-	WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
+	FCollisionQueryParams QueryParams;
+	FCollisionResponseParams ResponseParams;
+	const ECollisionChannel TraceChannel = InitHitscanCollision(QueryParams, ResponseParams);
+
+	const FVector TraceStart = ShotTransform.GetLocation();
+	const FVector AimDirection = ShotTransform.GetRotation().GetForwardVector();
+
+	TArray<FVector, TInlineAllocator<ShooterMaxPellets>> Directions;
+	GetPelletDirections(AimDirection, ShotId, Directions);
+
+	// remote players shot at where they saw their targets, so test characters at that time instead of now
+	const UShooterLagCompensation* LagCompensation = HasAuthority() ? GetWorld()->GetSubsystem<UShooterLagCompensation>() : nullptr;
+	const bool bLagCompensated = LagCompensation && LagCompensation->ShouldCompensate(PawnOwner);
+
+	if (bLagCompensated)
+	{
+		// present-time character capsules would block shots aimed at their past selves
+		TArray<AActor*> RecordedCharacters;
+		LagCompensation->GetRegisteredCharacters(RecordedCharacters);
+		QueryParams.AddIgnoredActors(RecordedCharacters);
+	}
+
+	// trace every pellet against the world
+	TArray<FHitResult, TInlineAllocator<ShooterMaxPellets>> Hits;
+	TArray<FVector, TInlineAllocator<ShooterMaxPellets>> TracerEnds;
+	Hits.SetNum(Directions.Num());
+	TracerEnds.SetNum(Directions.Num());
+
+	for (int32 i = 0; i < Directions.Num(); ++i)
+	{
+		const FVector TraceEnd = TraceStart + Directions[i] * Stats->HitscanRange;
+
+		GetWorld()->LineTraceSingleByChannel(Hits[i], TraceStart, TraceEnd, TraceChannel, QueryParams, ResponseParams);
+
+		// only characters in front of the world hit count
+		TracerEnds[i] = Hits[i].bBlockingHit ? Hits[i].ImpactPoint : TraceEnd;
+	}
+
+	if (bLagCompensated)
+	{
+		// rewind the characters once for every pellet
+		LagCompensation->TraceRewoundMany(TraceStart, TracerEnds, LagCompensation->GetShooterViewTime(PawnOwner), GetOwner(), Hits);
+
+		for (int32 i = 0; i < Hits.Num(); ++i)
+		{
+			if (Hits[i].bBlockingHit)
+			{
+				TracerEnds[i] = Hits[i].ImpactPoint;
+			}
+		}
+	}
+
+	// predicting clients only draw their own tracers
+	if (!HasAuthority())
+	{
+		for (int32 i = 0; i < Hits.Num(); ++i)
+		{
+			BP_OnHitscanTracer(TraceStart, TracerEnds[i], Hits[i].bBlockingHit);
+		}
+
+		return;
+	}
+
+	// resolve the hits the same way a projectile actor does
+	const AShooterProjectile* ProjectileDefaults = ProjectileClass->GetDefaultObject<AShooterProjectile>();
+
+	FShooterProjectileImpactParams Params;
+	Params.World = GetWorld();
+	Params.Settings = ProjectileDefaults;
+	Params.Instigator = PawnOwner;
+	Params.DamageCauser = this;
+	Params.Damage = Stats->HitDamage;
+	Params.bHasAuthority = true;
+
+	// group the pellets by the actor they hit, so each victim takes a single damage event
+	TArray<int32, TInlineAllocator<ShooterMaxPellets>> VictimHits;
+	TArray<int32, TInlineAllocator<ShooterMaxPellets>> VictimPellets;
+	const FHitResult* FirstHit = nullptr;
+
+	for (int32 i = 0; i < Hits.Num(); ++i)
+	{
+		if (!Hits[i].bBlockingHit)
+		{
+			continue;
+		}
+
+		if (!FirstHit)
+		{
+			FirstHit = &Hits[i];
+		}
+
+		// explosions are already merged by the explosion resolver
+		if (ProjectileDefaults->ExplodesOnHit())
+		{
+			AShooterProjectile::ResolveImpact(Params, Hits[i]);
+			continue;
+		}
+
+		const AActor* HitActor = Hits[i].GetActor();
+		const int32 VictimIndex = VictimHits.IndexOfByPredicate([&Hits, HitActor](int32 HitIndex) { return Hits[HitIndex].GetActor() == HitActor; });
+
+		if (VictimIndex == INDEX_NONE)
+		{
+			VictimHits.Add(i);
+			VictimPellets.Add(1);
+
+		} else {
+
+			++VictimPellets[VictimIndex];
+		}
+	}
+
+	for (int32 i = 0; i < VictimHits.Num(); ++i)
+	{
+		FShooterProjectileImpactParams VictimParams = Params;
+		VictimParams.Damage = Params.Damage * VictimPellets[i];
+		VictimParams.ImpulseScale = VictimPellets[i];
+
+		AShooterProjectile::ResolveImpact(VictimParams, Hits[VictimHits[i]]);
+	}
+
+	// one noise for the whole shot
+	if (FirstHit)
+	{
+		AShooterProjectile::ReportImpactNoise(Params, FirstHit->ImpactPoint);
+	}
+
+	// let everyone draw the tracers
+	if (Directions.Num() > 1)
+	{
+		// clients rebuild the pellets from the shot ID instead of receiving every tracer
+		if (GetNetMode() != NM_DedicatedServer)
+		{
+			for (int32 i = 0; i < Hits.Num(); ++i)
+			{
+				BP_OnHitscanTracer(TraceStart, TracerEnds[i], Hits[i].bBlockingHit);
+			}
+		}
+
+		MulticastPelletTracers(TraceStart, AimDirection, ShotId);
+
+	} else {
+
+		MulticastHitscanTracer(TraceStart, TracerEnds[0], Hits[0].bBlockingHit);
+	}
+}
+
+ECollisionChannel AShooterWeapon::InitHitscanCollision(FCollisionQueryParams& OutQueryParams, FCollisionResponseParams& OutResponseParams) const
+{
+	// trace with the collision settings of the projectile we'd otherwise launch
+	const USphereComponent* Collision = ProjectileClass->GetDefaultObject<AShooterProjectile>()->GetCollisionComponent();
+
+	OutQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(ShooterHitscan), false, this);
+	Collision->InitSweepCollisionParams(OutQueryParams, OutResponseParams);
+	OutQueryParams.AddIgnoredActor(GetOwner());
+
+	return Collision->GetCollisionObjectType();
+}
+
+void AShooterWeapon::MulticastHitscanTracer_Implementation(const FVector_NetQuantize& TraceStart, const FVector_NetQuantize& TraceEnd, bool bBlockingHit)
+{
+	// the owning client already drew its predicted tracer
+	if (!HasAuthority() && CanPredictProjectiles())
+	{
+		return;
+	}
+
+	BP_OnHitscanTracer(TraceStart, TraceEnd, bBlockingHit);
+}
+
+void AShooterWeapon::MulticastPelletTracers_Implementation(const FVector_NetQuantize& TraceStart, const FVector_NetQuantizeNormal& Direction, uint16 ShotId)
+{
+	// the server drew its tracers when it resolved the shot, and the owning client drew its predicted ones
+	if (HasAuthority() || CanPredictProjectiles() || !ProjectileClass)
+	{
+		return;
+	}
+
+	FCollisionQueryParams QueryParams;
+	FCollisionResponseParams ResponseParams;
+	const ECollisionChannel TraceChannel = InitHitscanCollision(QueryParams, ResponseParams);
+
+	// rebuild the same pellets the server traced
+	TArray<FVector, TInlineAllocator<ShooterMaxPellets>> Directions;
+	GetPelletDirections(Direction, ShotId, Directions);
+
+	for (const FVector& PelletDirection : Directions)
+	{
+		const FVector TraceEnd = TraceStart + PelletDirection * Stats->HitscanRange;
+
+		FHitResult Hit;
+		GetWorld()->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, TraceChannel, QueryParams, ResponseParams);
+
+		BP_OnHitscanTracer(TraceStart, Hit.bBlockingHit ? Hit.ImpactPoint : TraceEnd, Hit.bBlockingHit);
+	}
+}
+
+void AShooterWeapon::SpawnProjectile(const FTransform& ProjectileTransform, uint16 FirstShotId, float TimeSinceShot)
+{
+	// every pellet has its own ID so predictions and replicated impacts can be matched to it. The first one also seeds the spread
+	TArray<FVector, TInlineAllocator<ShooterMaxPellets>> Directions;
+	GetPelletDirections(ProjectileTransform.GetRotation().GetForwardVector(), FirstShotId, Directions);
+
+	TArray<FTransform, TInlineAllocator<ShooterMaxPellets>> PelletTransforms;
+
+	for (const FVector& Direction : Directions)
+	{
+		PelletTransforms.Emplace(Direction.Rotation(), ProjectileTransform.GetLocation(), ProjectileTransform.GetScale3D());
+	}
+
+	// owning clients only launch a local prediction. The server spawns the real projectiles
+	if (!HasAuthority())
+	{
+		if (CanPredictProjectiles())
+		{
+			for (int32 i = 0; i < PelletTransforms.Num(); ++i)
+			{
+				SpawnPredictedProjectile(PelletTransforms[i], static_cast<uint16>(FirstShotId + i), TimeSinceShot);
+			}
+		}
+
+		return;
+	}
+
+	// remote shooters fired a one way trip before the request got here, so catch their projectiles up to where they saw them
+	if (const UShooterLagCompensation* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensation>())
+	{
+		TimeSinceShot += LagCompensation->GetProjectileFastForwardTime(PawnOwner);
+	}
+
+	const AShooterProjectile* ProjectileDefaults = ProjectileClass ? ProjectileClass->GetDefaultObject<AShooterProjectile>() : nullptr;
+
+	// should clients rebuild the pellets from a single spawn record instead of replicating the actors?
+	if (ProjectileDefaults && ProjectileDefaults->ReplicatesSpawnOnly())
+	{
+		MulticastSpawnProjectile(MakeSpawnRecord(ProjectileTransform, FirstShotId, TimeSinceShot));
+	}
+
+	// batched pellets can only show their impacts through the response table, so spawn actors that run the Blueprint event if there's no table.
+	// The subsystem doesn't exist where impacts can't be seen, so a dedicated server still batches
+	const UShooterImpactEffects* ImpactEffects = GetWorld()->GetSubsystem<UShooterImpactEffects>();
+	const bool bCanShowBatchedImpacts = !ImpactEffects || ImpactEffects->HasResponses();
+
+	// should the pellets be simulated in bulk instead of spawning actors?
+	if (ProjectileDefaults && ProjectileDefaults->UsesBatchedSimulation() && bCanShowBatchedImpacts)
+	{
+		if (UShooterProjectileSimulation* Simulation = GetWorld()->GetSubsystem<UShooterProjectileSimulation>())
+		{
+			Simulation->SpawnProjectiles(ProjectileClass, PelletTransforms, PawnOwner, this, FirstShotId, TimeSinceShot);
+			return;
+		}
+	}
+
+	for (int32 i = 0; i < PelletTransforms.Num(); ++i)
+	{
+		LaunchProjectileActor(PelletTransforms[i], static_cast<uint16>(FirstShotId + i), TimeSinceShot);
+	}
+}
+
+void AShooterWeapon::LaunchProjectileActor(const FTransform& ProjectileTransform, uint16 ShotId, float TimeSinceShot)
+{
+	AShooterProjectile* Projectile = nullptr;
+
+	// get the projectile from the pool if we have one
+	if (UShooterProjectilePool* Pool = GetWorld()->GetSubsystem<UShooterProjectilePool>())
+	{
+		Projectile = Pool->AcquireProjectile(ProjectileClass, ProjectileTransform, GetOwner(), PawnOwner);
+
+	} else {
+
+		// spawn the projectile
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::OverrideRootScale;
+		SpawnParams.Owner = GetOwner();
+		SpawnParams.Instigator = PawnOwner;
+
+		Projectile = GetWorld()->SpawnActor<AShooterProjectile>(ProjectileClass, ProjectileTransform, SpawnParams);
+	}
+
+	if (Projectile)
+	{
+		Projectile->SetShotInfo(this, ShotId);
+		Projectile->AdvanceProjectile(TimeSinceShot);
+	}
+}
+
+FRandomStream AShooterWeapon::GetShotStream(uint16 ShotId, EShooterShotRandom Use) const
+{
+	// scramble the ID so consecutive shots get unrelated draws, then mix in the weapon and the use
+	const uint32 ShotSeed = HashCombine(static_cast<uint32>(WeaponSeed), MurmurFinalize32(ShotId));
+
+	return FRandomStream(static_cast<int32>(HashCombine(ShotSeed, static_cast<uint32>(Use))));
+}
+
+void AShooterWeapon::GetPelletDirections(const FVector& AimDirection, uint16 ShotId, TArray<FVector, TInlineAllocator<ShooterMaxPellets>>& OutDirections) const
+{
+	const int32 NumPellets = Stats->PelletCount;
+
+	// a single pellet flies straight along the aim
+	if (NumPellets == 1)
+	{
+		OutDirections.Add(AimDirection);
+		return;
+	}
+
+	FRandomStream PelletStream = GetShotStream(ShotId, EShooterShotRandom::PelletSpread);
+	const float ConeHalfAngle = FMath::DegreesToRadians(Stats->PelletSpread);
+
+	for (int32 i = 0; i < NumPellets; ++i)
+	{
+		OutDirections.Add(PelletStream.VRandCone(AimDirection, ConeHalfAngle));
+	}
+}
+
+int32 AShooterWeapon::GetBulletsAfterShots(int32 Bullets, int32 NumShots, bool* bOutReloaded) const
+{
+	if (bOutReloaded)
+	{
+		*bOutReloaded = NumShots >= Bullets;
+	}
+
+	if (NumShots < Bullets)
+	{
+		return Bullets - NumShots;
+	}
+
+	// the magazine is refilled every time the last bullet goes
+	return Stats->MagazineSize - (NumShots - Bullets) % Stats->MagazineSize;
+}
+
+void AShooterWeapon::ReconcileAmmo(uint16 ClientFireSequence, int32 ClientBullets)
+{
+	// find what our count was, or will be, after the same number of shots as the client
+	const int32 ShotsBehind = static_cast<int16>(FireSequence - ClientFireSequence);
+
+	if (ShotsBehind < ShooterAmmoHistorySize)
+	{
+		const int32 ServerBullets = ShotsBehind >= 0 ? BulletHistory[ClientFireSequence % ShooterAmmoHistorySize] : GetBulletsAfterShots(CurrentBullets, -ShotsBehind);
+
+		// the client agrees with us, so there's nothing to send
+		if (ClientBullets == ServerBullets)
+		{
+			return;
+		}
+
+		UE_LOG(LogSimpleShooter, Verbose, TEXT("%s: client predicted %d bullets at shot %d, server had %d"), *GetName(), ClientBullets, ClientFireSequence, ServerBullets);
+	}
+
+	// send our own count. The client replays whatever it predicted past it
+	ClientCorrectAmmo(FireSequence, CurrentBullets);
+}
+
+void AShooterWeapon::ClientCorrectAmmo_Implementation(uint16 Sequence, int32 Bullets)
+{
+	const int32 ShotsSinceCorrection = static_cast<int16>(FireSequence - Sequence);
+
+	if (ShotsSinceCorrection > 0)
+	{
+		// replay the shots we've predicted since the server's count
+		CurrentBullets = GetBulletsAfterShots(Bullets, ShotsSinceCorrection);
+
+	} else {
+
+		// the server has fired shots we never predicted, so take its count and shot number as they are
+		CurrentBullets = Bullets;
+		FireSequence = Sequence;
+	}
+
+	++PredictionStats.AmmoCorrections;
+
+	WeaponOwner->UpdateWeaponHUD(CurrentBullets, Stats->MagazineSize);
+}
+
+FShooterProjectileSpawnRecord AShooterWeapon::MakeSpawnRecord(const FTransform& ProjectileTransform, uint16 ShotId, float TimeSinceShot) const
+{
+	const UProjectileMovementComponent* Movement = ProjectileClass->GetDefaultObject<AShooterProjectile>()->GetProjectileMovement();
+	const float LaunchSpeed = Movement->InitialSpeed > 0.0f ? Movement->InitialSpeed : Movement->GetMaxSpeed();
+
+	FShooterProjectileSpawnRecord Record;
+	Record.Origin = ProjectileTransform.GetLocation();
+	Record.Direction = ProjectileTransform.GetRotation().GetForwardVector();
+	Record.Speed = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(LaunchSpeed), 0, static_cast<int32>(MAX_uint16)));
+	Record.ShotId = ShotId;
+
+	// refer to the projectile class by its registry index
+	if (AShooterGameState* GameState = GetWorld()->GetGameState<AShooterGameState>())
+	{
+		const int32 ClassIndex = GameState->GetProjectileClassIndex(ProjectileClass);
+
+		if (ClassIndex != INDEX_NONE)
+		{
+			Record.ClassIndex = static_cast<uint8>(ClassIndex);
+		}
+	}
+
+	if (const AGameStateBase* GameState = GetWorld()->GetGameState())
+	{
+		Record.ServerTime = GameState->GetServerWorldTimeSeconds() - TimeSinceShot;
+	}
+
+	return Record;
+}
+
+void AShooterWeapon::MulticastSpawnProjectile_Implementation(const FShooterProjectileSpawnRecord& Record)
+{
+	// the server already has the real projectile
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	SimulateProjectileFromRecord(Record);
+}
+
+void AShooterWeapon::MulticastProjectileImpact_Implementation(const FShooterProjectileImpactRecord& Record)
+{
+	// the server already played the impact on the real projectile
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	TWeakObjectPtr<AShooterProjectile> SimulatedProjectile;
+
+	if (SimulatedProjectiles.RemoveAndCopyValue(Record.ShotId, SimulatedProjectile))
+	{
+		// make sure the pool hasn't handed the projectile out to a different shot since
+		AShooterProjectile* Projectile = SimulatedProjectile.Get();
+
+		if (Projectile && !Projectile->IsInPool() && Projectile->GetShotId() == Record.ShotId)
+		{
+			Projectile->PlayAuthoritativeImpact(Record.Location, Record.Normal);
+		}
+	}
+}
+
+void AShooterWeapon::SimulateProjectileFromRecord(const FShooterProjectileSpawnRecord& Record)
+{
+	UShooterProjectilePool* Pool = GetWorld()->GetSubsystem<UShooterProjectilePool>();
+
+	// resolve the projectile class, falling back to our own if the registry hasn't replicated yet
+	TSubclassOf<AShooterProjectile> RecordClass = ProjectileClass;
+
+	if (Record.ClassIndex != ShooterProjectileClassIndexNone)
+	{
+		if (const AShooterGameState* GameState = GetWorld()->GetGameState<AShooterGameState>())
+		{
+			if (TSubclassOf<AShooterProjectile> RegisteredClass = GameState->GetProjectileClassByIndex(Record.ClassIndex))
+			{
+				RecordClass = RegisteredClass;
+			}
+		}
+	}
+
+	// catch up with the time the record spent on the wire
+	float TimeInFlight = 0.0f;
+
+	if (const AGameStateBase* GameState = GetWorld()->GetGameState())
+	{
+		TimeInFlight = FMath::Clamp(GameState->GetServerWorldTimeSeconds() - Record.ServerTime, 0.0f, MaxSpawnRecordCatchUpTime);
+	}
+
+	// rebuild the pellets of the shot from its ID and our replicated seed
+	TArray<FVector, TInlineAllocator<ShooterMaxPellets>> Directions;
+	GetPelletDirections(Record.Direction, Record.ShotId, Directions);
+
+	for (int32 i = 0; i < Directions.Num(); ++i)
+	{
+		const uint16 ShotId = static_cast<uint16>(Record.ShotId + i);
+
+		// did we already launch this pellet ourselves?
+		if (CanPredictProjectiles())
+		{
+			AShooterProjectile* PredictedProjectile = nullptr;
+
+			if (ReconcilePredictedShot(ShotId, Record.Origin, Directions[i], PredictedProjectile))
+			{
+				// keep our flight and let the authoritative impact snap it
+				if (PredictedProjectile)
+				{
+					SimulatedProjectiles.Add(ShotId, PredictedProjectile);
+				}
+
+				continue;
+			}
+		}
+
+		if (!Pool)
+		{
+			continue;
+		}
+
+		// get a local projectile from the pool
+		const FTransform SpawnTransform(Directions[i].Rotation(), Record.Origin);
+
+		AShooterProjectile* Projectile = Pool->AcquireProjectile(RecordClass, SpawnTransform, GetOwner(), PawnOwner);
+
+		if (!Projectile)
+		{
+			continue;
+		}
+
+		// this is only a visual, the server resolves the hit
+		Projectile->SetCosmeticOnly(true);
+		Projectile->SetShotInfo(this, ShotId);
+		Projectile->GetProjectileMovement()->Velocity = Directions[i] * Record.Speed;
+		Projectile->AdvanceProjectile(TimeInFlight);
+
+		SimulatedProjectiles.Add(ShotId, Projectile);
+	}
+
+	// forget about shots whose impact never arrived
+	if (SimulatedProjectiles.Num() > SimulatedProjectilePruneThreshold)
+	{
+		for (auto It = SimulatedProjectiles.CreateIterator(); It; ++It)
+		{
+			const AShooterProjectile* Simulated = It.Value().Get();
+
+			if (!Simulated || Simulated->IsInPool() || Simulated->GetShotId() != It.Key())
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+}
+
+void AShooterWeapon::SpawnPredictedProjectile(const FTransform& ProjectileTransform, uint16 ShotId, float TimeSinceShot)
+{
+	UShooterProjectilePool* Pool = GetWorld()->GetSubsystem<UShooterProjectilePool>();
+
+	if (!Pool)
+	{
+		return;
+	}
+
+	PruneExpiredPredictions();
+
+	AShooterProjectile* Projectile = Pool->AcquireProjectile(ProjectileClass, ProjectileTransform, GetOwner(), PawnOwner);
+
+	if (!Projectile)
+	{
+		return;
+	}
+
+	// the prediction is only a visual, the server resolves the hit
+	Projectile->SetCosmeticOnly(true);
+	Projectile->SetShotInfo(this, ShotId);
+	Projectile->AdvanceProjectile(TimeSinceShot);
+
+	// remember the launch so we can compare it with the server's
+	FShooterPredictedShot& PredictedShot = PredictedShots.Add(ShotId);
+	PredictedShot.Projectile = Projectile;
+	PredictedShot.Origin = ProjectileTransform.GetLocation();
+	PredictedShot.Direction = ProjectileTransform.GetRotation().GetForwardVector();
+	PredictedShot.FireTime = GetWorld()->GetTimeSeconds();
+
+	++PredictionStats.Predicted;
+}
+
+bool AShooterWeapon::ReconcilePredictedShot(uint16 ShotId, const FVector& Origin, const FVector& Direction, AShooterProjectile*& OutPredicted)
+{
+	OutPredicted = nullptr;
+
+	FShooterPredictedShot PredictedShot;
+
+	if (!PredictedShots.RemoveAndCopyValue(ShotId, PredictedShot))
+	{
+		// the server fired a shot we didn't predict
+		++PredictionStats.Unmatched;
+
+		UE_LOG(LogSimpleShooter, Verbose, TEXT("%s: shot %d has no prediction"), *GetName(), ShotId);
+		return false;
+	}
+
+	// measure how far the predicted launch line is from the authoritative one
+	const FVector AuthoritativeDirection = Direction.GetSafeNormal();
+	const float PositionError = FMath::PointDistToLine(PredictedShot.Origin, AuthoritativeDirection, Origin);
+	const float AngleError = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(FVector::DotProduct(PredictedShot.Direction, AuthoritativeDirection), -1.0f, 1.0f)));
+
+	// make sure the pool hasn't handed the predicted projectile out to a different shot since
+	AShooterProjectile* PredictedProjectile = PredictedShot.Projectile.Get();
+
+	if (PredictedProjectile && (PredictedProjectile->IsInPool() || PredictedProjectile->GetShotId() != ShotId))
+	{
+		PredictedProjectile = nullptr;
+	}
+
+	if (PositionError <= PredictionPositionTolerance && AngleError <= PredictionAngleTolerance)
+	{
+		++PredictionStats.Confirmed;
+
+		OutPredicted = PredictedProjectile;
+		return true;
+	}
+
+	++PredictionStats.Corrected;
+
+	UE_LOG(LogSimpleShooter, Verbose, TEXT("%s: shot %d mispredicted by %.1f cm and %.2f degrees"), *GetName(), ShotId, PositionError, AngleError);
+
+	// drop our version of the shot in favor of the server's
+	if (PredictedProjectile)
+	{
+		if (UShooterProjectilePool* Pool = GetWorld()->GetSubsystem<UShooterProjectilePool>())
+		{
+			Pool->ReleaseProjectile(PredictedProjectile);
+		}
+	}
+
+	return false;
+}
+
+void AShooterWeapon::PruneExpiredPredictions()
+{
+	const float ExpiryTime = GetWorld()->GetTimeSeconds() - PredictedShotTimeout;
+
+	for (auto It = PredictedShots.CreateIterator(); It; ++It)
+	{
+		if (It.Value().FireTime < ExpiryTime)
+		{
+			++PredictionStats.TimedOut;
+
+			UE_LOG(LogSimpleShooter, Verbose, TEXT("%s: shot %d was never confirmed"), *GetName(), It.Key());
+			It.RemoveCurrent();
+		}
+	}
 }
 
-FTransform AShooterWeapon::CalculateProjectileSpawnTransform(const FVector& TargetLocation) const
+bool AShooterWeapon::CanPredictProjectiles() const
 {
-	// find the muzzle location
-	const FVector MuzzleLoc = FirstPersonMesh->GetSocketLocation(MuzzleSocketName);
+	// only the owning client predicts
+	if (!bPredictProjectiles || HasAuthority() || !ProjectileClass || !PawnOwner || !PawnOwner->IsLocallyControlled())
+	{
+		return false;
+	}
+
+	// batched projectiles only reach clients through spawn records, so there would be nothing to reconcile with
+	const AShooterProjectile* ProjectileDefaults = ProjectileClass->GetDefaultObject<AShooterProjectile>();
+	return !ProjectileDefaults->UsesBatchedSimulation() || ProjectileDefaults->ReplicatesSpawnOnly();
+}
 
+void AShooterWeapon::ReconcilePredictedProjectile(AShooterProjectile* AuthoritativeProjectile)
+{
+	if (!CanPredictProjectiles())
+	{
+		return;
+	}
+
+	// the authoritative projectile may have flown a bit already, so compare launch lines rather than points
+	FVector Direction = AuthoritativeProjectile->GetProjectileMovement()->Velocity.GetSafeNormal();
+
+	if (Direction.IsNearlyZero())
+	{
+		Direction = AuthoritativeProjectile->GetActorForwardVector();
+	}
+
+	AShooterProjectile* PredictedProjectile = nullptr;
+
+	if (ReconcilePredictedShot(AuthoritativeProjectile->GetShotId(), AuthoritativeProjectile->GetActorLocation(), Direction, PredictedProjectile))
+	{
+		// our prediction is good, so keep showing it instead of the server's copy
+		AuthoritativeProjectile->HideForPredictedShot();
+	}
+}
+
+void AShooterWeapon::LogPredictionStats() const
+{
+	UE_LOG(LogSimpleShooter, Log, TEXT("Projectile prediction [%s]: predicted %d, confirmed %d, corrected %d, unmatched %d, timed out %d, ammo corrections %d"),
+		*GetName(), PredictionStats.Predicted, PredictionStats.Confirmed, PredictionStats.Corrected, PredictionStats.Unmatched, PredictionStats.TimedOut, PredictionStats.AmmoCorrections);
+}
+
+void AShooterWeapon::BroadcastProjectileImpact(uint16 ShotId, const FHitResult& Hit)
+{
+	FShooterProjectileImpactRecord Record;
+	Record.ShotId = ShotId;
+	Record.Location = Hit.Location;
+	Record.Normal = Hit.ImpactNormal;
+
+	MulticastProjectileImpact(Record);
+}
+
+FVector AShooterWeapon::GetMuzzleLocation() const
+{
+	return FirstPersonMesh->GetSocketLocation(MuzzleSocketName);
+}
+
+FTransform AShooterWeapon::CalculateProjectileSpawnTransform(const FVector& TargetLocation, const FVector& MuzzleLocation, uint16 ShotId) const
+{
 	// calculate the spawn location ahead of the muzzle
-	const FVector SpawnLoc = MuzzleLoc + ((TargetLocation - MuzzleLoc).GetSafeNormal() * MuzzleOffset);
+	const FVector SpawnLoc = MuzzleLocation + ((TargetLocation - MuzzleLocation).GetSafeNormal() * Stats->MuzzleOffset);
+
+	// find the aim rotation vector while applying some variance to the target. The variance comes from the shot's stream so predictions match the server
+	FRandomStream AimStream = GetShotStream(ShotId, EShooterShotRandom::AimVariance);
 
-	// find the aim rotation vector while applying some variance to the target 
-	const FRotator AimRot = UKismetMathLibrary::FindLookAtRotation(SpawnLoc, TargetLocation + (UKismetMathLibrary::RandomUnitVector() * AimVariance));
+	const FRotator AimRot = UKismetMathLibrary::FindLookAtRotation(SpawnLoc, TargetLocation + (AimStream.VRand() * Stats->AimVariance));
 
 	// return the built transform
 	return FTransform(AimRot, SpawnLoc, FVector::OneVector);
 }
 
+void AShooterWeapon::CompileStats(FShooterWeaponStatBlock& OutStats) const
+{
+	OutStats.WeaponClass = GetClass();
+	OutStats.ProjectileClass = ProjectileClass.Get();
+	OutStats.RefireRate = RefireRate;
+	OutStats.AimVariance = AimVariance;
+	OutStats.FiringRecoil = FiringRecoil;
+	OutStats.MuzzleOffset = MuzzleOffset;
+	OutStats.HitscanRange = HitscanRange;
+	OutStats.PelletSpread = PelletSpread;
+	OutStats.HitDamage = ProjectileClass ? ProjectileClass->GetDefaultObject<AShooterProjectile>()->GetHitDamage() : 0.0f;
+	OutStats.ShotLoudness = ShotLoudness;
+	OutStats.ShotNoiseRange = ShotNoiseRange;
+	OutStats.MagazineSize = FMath::Max(MagazineSize, 1);
+	OutStats.PelletCount = static_cast<uint8>(FMath::Clamp(PelletCount, 1, ShooterMaxPellets));
+	OutStats.MaxShotsPerFrame = static_cast<uint8>(FMath::Clamp(MaxShotsPerFrame, 1, static_cast<int32>(MAX_uint8)));
+	OutStats.bFullAuto = bFullAuto;
+	OutStats.bHitscan = bHitscan;
+}
+
 const TSubclassOf<UAnimInstance>& AShooterWeapon::GetFirstPersonAnimInstanceClass() const
 {
 	return FirstPersonAnimInstanceClass;
@@ -221,19 +1088,43 @@ const TSubclassOf<UAnimInstance>& AShooterWeapon::GetThirdPersonAnimInstanceClas
 	return ThirdPersonAnimInstanceClass;
 }
 
-void AShooterWeapon::OnRep_MagazineSize()
+void AShooterWeapon::UpdateNetState(bool bReloaded)
 {
-	if (WeaponOwner)
+	if (!HasAuthority())
 	{
-		WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
+		return;
+	}
+
+	NetState.Bullets = static_cast<uint8>(FMath::Clamp(CurrentBullets, 0, (1 << ShooterWeaponBulletBits) - 1));
+	NetState.bIsFiring = bIsFiring;
+
+	if (bReloaded)
+	{
+		NetState.ReloadCount = (NetState.ReloadCount + 1) % (1 << ShooterWeaponReloadBits);
 	}
 }
 
-void AShooterWeapon::OnRep_CurrentBullets()
+void AShooterWeapon::OnRep_NetState(const FShooterWeaponNetState& PreviousNetState)
 {
+	// the fire state stays in the net state, so simulated weapons don't start shooting on their own
+	CurrentBullets = NetState.Bullets;
+
 	if (WeaponOwner)
 	{
-		WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
+		WeaponOwner->UpdateWeaponHUD(CurrentBullets, GetMagazineSize());
+	}
+
+	// the fire and reload flags only drive cosmetics here
+	if (NetState.bIsFiring != PreviousNetState.bIsFiring)
+	{
+		BP_OnRemoteFiringChanged(NetState.bIsFiring);
+	}
+
+	// any change in the counter means at least one magazine was loaded since the last update.
+	// The first update only brings us up to date, it isn't a reload
+	if (NetState.ReloadCount != PreviousNetState.ReloadCount && HasActorBegunPlay())
+	{
+		BP_OnRemoteReload();
 	}
 }
 
@@ -241,6 +1132,6 @@ void AShooterWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLi
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(AShooterWeapon, CurrentBullets);
-	DOREPLIFETIME(AShooterWeapon, MagazineSize);
+	DOREPLIFETIME_CONDITION(AShooterWeapon, NetState, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AShooterWeapon, WeaponSeed, COND_InitialOnly);
 }
@@ -6,6 +6,9 @@
 #include "GameFramework/Actor.h"
 #include "ShooterWeaponHolder.h"
 #include "Animation/AnimInstance.h"
+#include "ShooterProjectileSpawnRecord.h"
+#include "ShooterWeaponStats.h"
+#include "ShooterWeaponNetState.h"
 #include "ShooterWeapon.generated.h"
 
 class IShooterWeaponHolder;
@@ -14,6 +17,70 @@ class USkeletalMeshComponent;
 class UAnimMontage;
 class UAnimInstance;
 
+/** Max number of pellets a single shot can launch */
+static constexpr int32 ShooterMaxPellets = 32;
+
+/** Number of recent shots the server remembers its bullet count for, to compare with the owning client's prediction */
+static constexpr int32 ShooterAmmoHistorySize = 32;
+
+/**
+ *  Independent random draws made for a single shot
+ *  Each one gets its own stream, so a machine can rebuild one without replaying the others
+ */
+enum class EShooterShotRandom : uint8
+{
+	/** Aim variance applied by the weapon */
+	AimVariance,
+
+	/** Spread of the pellets around the aim */
+	PelletSpread,
+
+	/** Aim error applied by the weapon owner before the shot */
+	OwnerAim
+};
+
+/**
+ *  Projectile launched locally by the owning client ahead of the server
+ */
+struct FShooterPredictedShot
+{
+	/** Local projectile showing the shot */
+	TWeakObjectPtr<AShooterProjectile> Projectile;
+
+	/** Predicted launch location */
+	FVector Origin = FVector::ZeroVector;
+
+	/** Predicted launch direction */
+	FVector Direction = FVector::ForwardVector;
+
+	/** World time the shot was predicted at */
+	float FireTime = 0.0f;
+};
+
+/**
+ *  Counters describing how well predicted shots matched the server
+ */
+struct FShooterPredictionStats
+{
+	/** Shots launched locally ahead of the server */
+	int32 Predicted = 0;
+
+	/** Predicted shots the server confirmed within tolerance */
+	int32 Confirmed = 0;
+
+	/** Predicted shots replaced by the authoritative projectile because they were too far off */
+	int32 Corrected = 0;
+
+	/** Authoritative shots that had no matching prediction */
+	int32 Unmatched = 0;
+
+	/** Predicted shots the server never confirmed */
+	int32 TimedOut = 0;
+
+	/** Times the server corrected the predicted ammo count */
+	int32 AmmoCorrections = 0;
+};
+
 /**
  *  Base class for a simple first person shooter weapon
  *  Provides both first person and third person perspective meshes
@@ -43,12 +110,21 @@ protected:
 	TSubclassOf<AShooterProjectile> ProjectileClass;
 
 	/** Number of bullets in a magazine */
-	UPROPERTY(ReplicatedUsing = OnRep_MagazineSize, EditAnywhere, Category="Ammo", meta = (ClampMin = 0, ClampMax = 100))
+	UPROPERTY(EditAnywhere, Category="Ammo", meta = (ClampMin = 0, ClampMax = 100))
 	int32 MagazineSize = 10;
 
-	UPROPERTY(ReplicatedUsing = OnRep_CurrentBullets)
-	/** Number of bullets in the current magazine */
+	/** Number of bullets in the current magazine. The owning client predicts it, everyone else receives it through the net state */
 	int32 CurrentBullets = 0;
+
+	/** Packed runtime state, replicated to everyone but the owning client, which predicts its own */
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FShooterWeaponNetState NetState;
+
+	/** Number of shots fired. Lines server ammo corrections up with the shots the owning client predicted */
+	uint16 FireSequence = 0;
+
+	/** Bullet count after each recent shot, indexed by fire sequence. Server only */
+	int32 BulletHistory[ShooterAmmoHistorySize] = {};
 	
 	/** Animation montage to play when firing this weapon */
 	UPROPERTY(EditAnywhere, Category="Animation")
@@ -78,6 +154,22 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Aim", meta = (ClampMin = 0, ClampMax = 1000, Units = "cm"))
 	float MuzzleOffset = 10.0f;
 
+	/** If true, shots resolve as a single trace instead of launching a projectile. The projectile class still provides the damage settings */
+	UPROPERTY(EditAnywhere, Category="Hitscan")
+	bool bHitscan = false;
+
+	/** Max distance a hitscan shot can travel */
+	UPROPERTY(EditAnywhere, Category="Hitscan", meta = (EditCondition = "bHitscan", ClampMin = 0, ClampMax = 100000, Units = "cm"))
+	float HitscanRange = 20000.0f;
+
+	/** Number of pellets launched by each shot. Pellets share the shot's ammo, noise and replication, and are resolved as one batch */
+	UPROPERTY(EditAnywhere, Category="Pellets", meta = (ClampMin = 1, ClampMax = 32))
+	int32 PelletCount = 1;
+
+	/** Cone half-angle the pellets of a shot are spread over. The pattern is seeded by the shot ID and weapon seed so every machine rebuilds the same one */
+	UPROPERTY(EditAnywhere, Category="Pellets", meta = (EditCondition = "PelletCount > 1", ClampMin = 0, ClampMax = 45, Units = "Degrees"))
+	float PelletSpread = 5.0f;
+
 	/** If true, this weapon will automatically fire at the refire rate */
 	UPROPERTY(EditAnywhere, Category="Refire")
 	bool bFullAuto = false;
@@ -86,15 +178,75 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Refire", meta = (ClampMin = 0, ClampMax = 5, Units = "s"))
 	float RefireRate = 0.5f;
 
+	/** Max number of full auto shots fired in a single frame. Shots owed beyond this after a hitch are dropped */
+	UPROPERTY(EditAnywhere, Category="Refire", meta = (ClampMin = 1, ClampMax = 32))
+	int32 MaxShotsPerFrame = 8;
+
 	/** Game time of last shot fired, used to enforce refire rate on semi auto */
 	float TimeOfLastShot = 0.0f;
 
+	/** Game time the next full auto shot is due. Full auto shots are scheduled from the weapon tick so several can fire in one frame */
+	float NextShotTime = 0.0f;
+
+	/** Muzzle location at the end of the previous frame, used to interpolate shots fired between frames */
+	FVector PreviousMuzzleLocation = FVector::ZeroVector;
+
+	/** Aim target at the end of the previous frame, used to interpolate shots fired between frames */
+	FVector PreviousTargetLocation = FVector::ZeroVector;
+
+	/** Game time PreviousMuzzleLocation and PreviousTargetLocation were sampled at */
+	float PreviousAimTime = 0.0f;
+
 	/** If true, the weapon is currently firing */
 	bool bIsFiring = false;
 
 	/** Timer to handle full auto refiring */
 	FTimerHandle RefireTimer;
 
+	/** ID to give the next shot fired by this weapon */
+	uint16 NextShotId = 0;
+
+	/** Handed out by the game mode when the weapon spawns. Combined with the shot ID, seeds every random draw of a shot so all machines make the same ones */
+	UPROPERTY(Replicated)
+	int32 WeaponSeed = 0;
+
+	/** Client-side simulations of projectiles replicated through spawn records, keyed by shot ID */
+	TMap<uint16, TWeakObjectPtr<AShooterProjectile>> SimulatedProjectiles;
+
+	/** If true, the owning client launches its projectiles right away instead of waiting for the server */
+	UPROPERTY(EditAnywhere, Category="Prediction")
+	bool bPredictProjectiles = true;
+
+	/** Max distance between the predicted and authoritative launch lines for a prediction to be kept */
+	UPROPERTY(EditAnywhere, Category="Prediction", meta = (ClampMin = 0, ClampMax = 1000, Units = "cm"))
+	float PredictionPositionTolerance = 50.0f;
+
+	/** Max angle between the predicted and authoritative launch directions for a prediction to be kept */
+	UPROPERTY(EditAnywhere, Category="Prediction", meta = (ClampMin = 0, ClampMax = 90, Units = "Degrees"))
+	float PredictionAngleTolerance = 3.0f;
+
+	/** Time to wait for the server to confirm a predicted shot before giving up on it */
+	UPROPERTY(EditAnywhere, Category="Prediction", meta = (ClampMin = 0, ClampMax = 5, Units = "s"))
+	float PredictedShotTimeout = 1.0f;
+
+	/** Shots predicted by the owning client that the server hasn't confirmed yet, keyed by shot ID */
+	TMap<uint16, FShooterPredictedShot> PredictedShots;
+
+	/** Prediction accuracy counters */
+	FShooterPredictionStats PredictionStats;
+
+	/** Compiled tuning read by the fire path. Set on BeginPlay */
+	const FShooterWeaponStatBlock* Stats = nullptr;
+
+	/** Private copy of the compiled tuning, only used if the weapon stats subsystem couldn't give this class an ID */
+	TUniquePtr<FShooterWeaponStatBlock> LocalStats;
+
+	/** ID of this weapon's class in the weapon stats subsystem */
+	uint8 WeaponId = ShooterWeaponIdNone;
+
+	/** Weapon ID to send over the network. ShooterWeaponIdNone if the ID was handed out locally */
+	uint8 NetWeaponId = ShooterWeaponIdNone;
+
 	/** Cast pawn pointer to the owner for AI perception system interactions */
 	TObjectPtr<APawn> PawnOwner;
 
@@ -123,6 +275,11 @@ protected:
 	/** Gameplay Cleanup */
 	virtual void EndPlay(EEndPlayReason::Type EndPlayReason) override;
 
+public:
+
+	/** Fires the full auto shots owed this frame */
+	virtual void Tick(float DeltaTime) override;
+
 protected:
 
 	/** Called when the weapon's owner is destroyed */
@@ -148,14 +305,122 @@ protected:
 	/** Fire the weapon */
 	virtual void Fire();
 
+	/** Fires one shot that left the weapon the given time ago, and makes its noise */
+	void FireShot(const FVector& TargetLocation, const FVector& MuzzleLocation, float TimeSinceShot);
+
+	/** Fires every full auto shot that came due since the last frame, interpolating the aim between frames */
+	void FireOwedShots();
+
+	/** Stores the current muzzle and aim so the next frame's shots can be interpolated */
+	void SampleAim(const FVector& TargetLocation, const FVector& MuzzleLocation);
+
 	/** Called when the refire rate time has passed while shooting semi auto weapons */
 	void FireCooldownExpired();
 
-	/** Fire a projectile towards the target location */
-	virtual void FireProjectile(const FVector& TargetLocation);
+	/** Fire a projectile from the muzzle location towards the target location. TimeSinceShot is how long ago the shot left the weapon */
+	virtual void FireProjectile(const FVector& TargetLocation, const FVector& MuzzleLocation, float TimeSinceShot);
+
+	/** Resolves a hitscan shot along the forward vector of the given transform. Every pellet is traced in one batch and damage is applied once per victim */
+	void FireHitscan(const FTransform& ShotTransform, uint16 ShotId);
+
+	/** Sets up the hitscan trace parameters from the projectile collision. Returns the channel to trace on */
+	ECollisionChannel InitHitscanCollision(FCollisionQueryParams& OutQueryParams, FCollisionResponseParams& OutResponseParams) const;
+
+	/** Sends the cosmetic tracer of a hitscan shot to clients */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastHitscanTracer(const FVector_NetQuantize& TraceStart, const FVector_NetQuantize& TraceEnd, bool bBlockingHit);
+
+	/** Sends a multi-pellet hitscan shot to clients, which rebuild and trace the pellets locally to draw their tracers */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastPelletTracers(const FVector_NetQuantize& TraceStart, const FVector_NetQuantizeNormal& Direction, uint16 ShotId);
+
+	/** Passes control to Blueprint to draw the tracer of a hitscan shot */
+	UFUNCTION(BlueprintImplementableEvent, Category="Weapon", meta = (DisplayName = "On Hitscan Tracer"))
+	void BP_OnHitscanTracer(const FVector& TraceStart, const FVector& TraceEnd, bool bBlockingHit);
+
+	/** Passes control to Blueprint when a weapon held by someone else starts or stops firing */
+	UFUNCTION(BlueprintImplementableEvent, Category="Weapon", meta = (DisplayName = "On Remote Firing Changed"))
+	void BP_OnRemoteFiringChanged(bool bFiring);
+
+	/** Passes control to Blueprint when a weapon held by someone else loads a new magazine */
+	UFUNCTION(BlueprintImplementableEvent, Category="Weapon", meta = (DisplayName = "On Remote Reload"))
+	void BP_OnRemoteReload();
+
+	/** Launches the pellets of a shot at the given transform through the simulation, the pool or a plain spawn. Pellets get consecutive IDs starting at FirstShotId */
+	void SpawnProjectile(const FTransform& ProjectileTransform, uint16 FirstShotId, float TimeSinceShot = 0.0f);
+
+	/** Launches a single projectile actor, from the pool if we have one */
+	void LaunchProjectileActor(const FTransform& ProjectileTransform, uint16 ShotId, float TimeSinceShot);
+
+	/** Fills the launch direction of every pellet of a shot, spread around its aim direction by the shot's random stream */
+	void GetPelletDirections(const FVector& AimDirection, uint16 ShotId, TArray<FVector, TInlineAllocator<ShooterMaxPellets>>& OutDirections) const;
+
+	/** Returns the bullet count left after firing a number of shots from the given count, reloading whenever the magazine runs dry. Optionally reports whether any reload happened */
+	int32 GetBulletsAfterShots(int32 Bullets, int32 NumShots, bool* bOutReloaded = nullptr) const;
+
+	/** Overrides the owning client's predicted ammo with the server's count as of the given shot */
+	UFUNCTION(Client, Reliable)
+	void ClientCorrectAmmo(uint16 Sequence, int32 Bullets);
+
+	/** Builds the compact spawn record replicated for a projectile launch */
+	FShooterProjectileSpawnRecord MakeSpawnRecord(const FTransform& ProjectileTransform, uint16 ShotId, float TimeSinceShot) const;
+
+	/** Replicates a projectile launch to clients as a spawn record */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastSpawnProjectile(const FShooterProjectileSpawnRecord& Record);
+
+	/** Replicates the authoritative impact of a projectile launched with a spawn record */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastProjectileImpact(const FShooterProjectileImpactRecord& Record);
+
+	/** Starts a local simulation of the projectiles described by a spawn record, one per pellet */
+	void SimulateProjectileFromRecord(const FShooterProjectileSpawnRecord& Record);
 
-	/** Calculates the spawn transform for projectiles shot by this weapon */
-	FTransform CalculateProjectileSpawnTransform(const FVector& TargetLocation) const;
+	/** Launches a local projectile on the owning client ahead of the server */
+	void SpawnPredictedProjectile(const FTransform& ProjectileTransform, uint16 ShotId, float TimeSinceShot);
+
+	/**
+	 *  Compares a predicted shot with its authoritative launch and updates the prediction counters
+	 *  Returns true if the prediction should be kept. OutPredicted is the predicted projectile if it's still flying
+	 */
+	bool ReconcilePredictedShot(uint16 ShotId, const FVector& Origin, const FVector& Direction, AShooterProjectile*& OutPredicted);
+
+	/** Gives up on predicted shots the server never confirmed */
+	void PruneExpiredPredictions();
+
+public:
+
+	/** Tells the clients simulating the given shot where it hit on the server */
+	void BroadcastProjectileImpact(uint16 ShotId, const FHitResult& Hit);
+
+	/** Returns true if the owning client should launch projectiles ahead of the server */
+	bool CanPredictProjectiles() const;
+
+	/** Returns the ID the next shot will get */
+	uint16 GetNextShotId() const { return NextShotId; };
+
+	/** Syncs the shot counter with the owning client so predicted and authoritative shots share IDs */
+	void SetNextShotId(uint16 ShotId) { NextShotId = ShotId; };
+
+	/** Returns the random stream for one use of the given shot. The server and the owning client build the same stream for the same shot */
+	FRandomStream GetShotStream(uint16 ShotId, EShooterShotRandom Use) const;
+
+	/** Matches a replicated authoritative projectile with the local prediction of its shot */
+	void ReconcilePredictedProjectile(AShooterProjectile* AuthoritativeProjectile);
+
+	/** Returns the prediction accuracy counters */
+	const FShooterPredictionStats& GetPredictionStats() const { return PredictionStats; };
+
+	/** Logs the prediction accuracy counters */
+	void LogPredictionStats() const;
+
+protected:
+
+	/** Returns the current location of the muzzle socket */
+	FVector GetMuzzleLocation() const;
+
+	/** Calculates the spawn transform for projectiles shot by this weapon from the given muzzle location, with the aim variance drawn from the shot's stream */
+	FTransform CalculateProjectileSpawnTransform(const FVector& TargetLocation, const FVector& MuzzleLocation, uint16 ShotId) const;
 
 public:
 
@@ -167,6 +432,18 @@ public:
 	UFUNCTION(BlueprintPure, Category="Weapon")
 	USkeletalMeshComponent* GetThirdPersonMesh() const { return ThirdPersonMesh; };
 
+	/** Fills a stat block from this weapon's tuning. Called on the class defaults */
+	void CompileStats(FShooterWeaponStatBlock& OutStats) const;
+
+	/** Returns the compiled tuning of this weapon. Only valid after BeginPlay */
+	const FShooterWeaponStatBlock& GetStats() const { return *Stats; };
+
+	/** Returns the ID of this weapon's class in the weapon stats subsystem */
+	uint8 GetWeaponId() const { return WeaponId; };
+
+	/** Returns the weapon ID to send over the network, or ShooterWeaponIdNone if this class has no stable ID */
+	uint8 GetNetWeaponId() const { return NetWeaponId; };
+
 	/** Returns the first person anim instance class */
 	const TSubclassOf<UAnimInstance>& GetFirstPersonAnimInstanceClass() const;
 
@@ -174,18 +451,28 @@ public:
 	const TSubclassOf<UAnimInstance>& GetThirdPersonAnimInstanceClass() const;
 
 	/** Returns the magazine size */
-	int32 GetMagazineSize() const { return MagazineSize; };
+	int32 GetMagazineSize() const { return Stats ? Stats->MagazineSize : MagazineSize; };
 
 	/** Returns the current bullet count */
 	int32 GetBulletCount() const { return CurrentBullets; }
 
+	/** Returns the replicated runtime state. Only kept up to date on the server and non-owning clients */
+	const FShooterWeaponNetState& GetNetState() const { return NetState; };
+
+	/** Returns the number of shots fired so far */
+	uint16 GetFireSequence() const { return FireSequence; };
+
+	/** Compares the owning client's predicted ammo with our count at the same shot, and sends a correction if they differ. Never changes our own shot count */
+	void ReconcileAmmo(uint16 ClientFireSequence, int32 ClientBullets);
+
 
 protected:
 	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const;
 
-	UFUNCTION()
-	void OnRep_MagazineSize();
+	/** Copies the current ammo and fire state into the replicated net state, counting a reload if the last shot loaded a new magazine. Server only */
+	void UpdateNetState(bool bReloaded = false);
 
+	/** Updates the bullet count from the replicated net state and plays the fire and reload cosmetics */
 	UFUNCTION()
-	void OnRep_CurrentBullets();
+	void OnRep_NetState(const FShooterWeaponNetState& PreviousNetState);
 };
@@ -0,0 +1,26 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterWeaponNetState.h"
+
+bool FShooterWeaponNetState::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	// bullet count in a few bits
+	uint32 PackedBullets = Bullets;
+	Ar.SerializeInt(PackedBullets, 1 << ShooterWeaponBulletBits);
+	Bullets = static_cast<uint8>(PackedBullets);
+
+	// one bit for the fire flag
+	uint8 FiringBit = bIsFiring ? 1 : 0;
+	Ar.SerializeBits(&FiringBit, 1);
+	bIsFiring = FiringBit != 0;
+
+	// the reload counter only needs enough bits to show it changed
+	uint32 PackedReloads = ReloadCount;
+	Ar.SerializeInt(PackedReloads, 1 << ShooterWeaponReloadBits);
+	ReloadCount = static_cast<uint8>(PackedReloads);
+
+	return true;
+}
@@ -0,0 +1,52 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "ShooterWeaponNetState.generated.h"
+
+/** Number of bits the bullet count is packed into. Covers the magazine size clamp */
+static constexpr int32 ShooterWeaponBulletBits = 7;
+
+/** Number of bits the reload counter is packed into. It wraps, so only the change between updates matters */
+static constexpr int32 ShooterWeaponReloadBits = 2;
+
+/**
+ *  Runtime state of a weapon, replicated to everyone but its owner as a single property
+ */
+USTRUCT()
+struct FShooterWeaponNetState
+{
+	GENERATED_BODY()
+
+	/** Number of bullets in the current magazine */
+	UPROPERTY()
+	uint8 Bullets = 0;
+
+	/** If true, the trigger is held. Drives firing cosmetics on other machines */
+	UPROPERTY()
+	bool bIsFiring = false;
+
+	/** Wrapping count of the magazines loaded. Drives reload cosmetics on other machines whenever it changes */
+	UPROPERTY()
+	uint8 ReloadCount = 0;
+
+	/** Packs the state into 10 bits */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FShooterWeaponNetState& Other) const
+	{
+		return Bullets == Other.Bullets && bIsFiring == Other.bIsFiring && ReloadCount == Other.ReloadCount;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterWeaponNetState> : public TStructOpsTypeTraitsBase2<FShooterWeaponNetState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
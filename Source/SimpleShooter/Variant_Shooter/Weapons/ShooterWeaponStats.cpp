@@ -0,0 +1,137 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterWeaponStats.h"
+#include "ShooterWeapon.h"
+#include "ShooterPickup.h"
+#include "SimpleShooter.h"
+
+void UShooterWeaponStats::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// blocks are handed out by pointer, so make sure the array never reallocates
+	StatBlocks.Reserve(ShooterWeaponIdNone);
+
+	const UDataTable* LoadedWeaponTable = WeaponTable.LoadSynchronous();
+
+	if (!LoadedWeaponTable)
+	{
+		return;
+	}
+
+	if (LoadedWeaponTable->GetRowStruct() != FWeaponTableRow::StaticStruct())
+	{
+		UE_LOG(LogSimpleShooter, Warning, TEXT("ShooterWeaponStats: %s doesn't use FWeaponTableRow and will be ignored"), *LoadedWeaponTable->GetName());
+		return;
+	}
+
+	// reserve in table order so every machine hands out the same IDs. The classes themselves stream in later
+	for (const TPair<FName, uint8*>& Row : LoadedWeaponTable->GetRowMap())
+	{
+		const FWeaponTableRow* WeaponData = reinterpret_cast<const FWeaponTableRow*>(Row.Value);
+
+		// copy the row for the pickups offering it
+		FShooterWeaponTableEntry& Entry = TableEntries.Add(Row.Key);
+		Entry.StaticMesh = WeaponData->StaticMesh;
+		Entry.WeaponToSpawn = WeaponData->WeaponToSpawn;
+
+		if (WeaponData->WeaponToSpawn.IsNull() || ReservedIds.Contains(WeaponData->WeaponToSpawn.ToSoftObjectPath()) || StatBlocks.Num() >= ShooterWeaponIdNone)
+		{
+			continue;
+		}
+
+		const uint8 WeaponId = static_cast<uint8>(StatBlocks.Num());
+		StatBlocks.AddDefaulted_GetRef().WeaponId = WeaponId;
+
+		ReservedIds.Add(WeaponData->WeaponToSpawn.ToSoftObjectPath(), WeaponId);
+	}
+
+	NumTableIds = StatBlocks.Num();
+}
+
+void UShooterWeaponStats::Deinitialize()
+{
+	StatBlocks.Empty();
+	WeaponIds.Empty();
+	ReservedIds.Empty();
+	TableEntries.Empty();
+	NumTableIds = 0;
+	CompiledClasses.Empty();
+
+	Super::Deinitialize();
+}
+
+uint8 UShooterWeaponStats::RegisterWeaponClass(TSubclassOf<AShooterWeapon> WeaponClass)
+{
+	if (!WeaponClass)
+	{
+		return ShooterWeaponIdNone;
+	}
+
+	// already compiled?
+	if (const uint8* WeaponId = WeaponIds.Find(WeaponClass.Get()))
+	{
+		return *WeaponId;
+	}
+
+	uint8 WeaponId = ShooterWeaponIdNone;
+
+	// use the ID reserved by the weapon table, or take the next free one
+	if (!ReservedIds.RemoveAndCopyValue(FSoftObjectPath(WeaponClass.Get()), WeaponId))
+	{
+		if (StatBlocks.Num() >= ShooterWeaponIdNone)
+		{
+			UE_LOG(LogSimpleShooter, Error, TEXT("ShooterWeaponStats: out of weapon IDs, %s won't be compiled"), *WeaponClass->GetName());
+			return ShooterWeaponIdNone;
+		}
+
+		WeaponId = static_cast<uint8>(StatBlocks.Num());
+		StatBlocks.AddDefaulted();
+
+		UE_LOG(LogSimpleShooter, Warning, TEXT("ShooterWeaponStats: %s isn't in the weapon table, so its weapon ID is local and won't be replicated"), *WeaponClass->GetName());
+	}
+
+	FShooterWeaponStatBlock& Stats = StatBlocks[WeaponId];
+	WeaponClass->GetDefaultObject<AShooterWeapon>()->CompileStats(Stats);
+	Stats.WeaponId = WeaponId;
+
+	WeaponIds.Add(WeaponClass.Get(), WeaponId);
+
+	CompiledClasses.Add(WeaponClass.Get());
+
+	if (Stats.ProjectileClass)
+	{
+		CompiledClasses.Add(const_cast<UClass*>(Stats.ProjectileClass));
+	}
+
+	return WeaponId;
+}
+
+uint8 UShooterWeaponStats::FindWeaponId(const UClass* WeaponClass) const
+{
+	if (const uint8* WeaponId = WeaponIds.Find(WeaponClass))
+	{
+		return *WeaponId;
+	}
+
+	const uint8* ReservedId = WeaponClass ? ReservedIds.Find(FSoftObjectPath(WeaponClass)) : nullptr;
+
+	return ReservedId ? *ReservedId : ShooterWeaponIdNone;
+}
+
+const FShooterWeaponTableEntry* UShooterWeaponStats::FindTableEntry(FName RowName) const
+{
+	return TableEntries.Find(RowName);
+}
+
+const FShooterWeaponStatBlock* UShooterWeaponStats::GetStats(uint8 WeaponId) const
+{
+	// reserved blocks aren't compiled until their class streams in
+	return StatBlocks.IsValidIndex(WeaponId) && StatBlocks[WeaponId].WeaponClass ? &StatBlocks[WeaponId] : nullptr;
+}
+
+TSubclassOf<AShooterWeapon> UShooterWeaponStats::GetWeaponClass(uint8 WeaponId) const
+{
+	return StatBlocks.IsValidIndex(WeaponId) ? const_cast<UClass*>(StatBlocks[WeaponId].WeaponClass) : nullptr;
+}
@@ -0,0 +1,149 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Engine/DataTable.h"
+#include "ShooterWeaponStats.generated.h"
+
+class AShooterWeapon;
+class AShooterProjectile;
+class UStaticMesh;
+
+/** Weapon ID meaning "no compiled stats" */
+static constexpr uint8 ShooterWeaponIdNone = MAX_uint8;
+
+/**
+ *  Immutable tuning of a weapon class, compiled once from its class defaults
+ *  Sized and aligned to a single cache line so the fire path reads one contiguous record
+ */
+struct alignas(64) FShooterWeaponStatBlock
+{
+	/** Weapon class the stats were compiled from */
+	const UClass* WeaponClass = nullptr;
+
+	/** Type of projectiles the weapon shoots */
+	const UClass* ProjectileClass = nullptr;
+
+	/** Time between shots */
+	float RefireRate = 0.5f;
+
+	/** Cone half-angle for variance while aiming */
+	float AimVariance = 0.0f;
+
+	/** Amount of firing recoil to apply to the owner */
+	float FiringRecoil = 0.0f;
+
+	/** Distance ahead of the muzzle that bullets spawn at */
+	float MuzzleOffset = 10.0f;
+
+	/** Max distance a hitscan shot can travel */
+	float HitscanRange = 20000.0f;
+
+	/** Cone half-angle the pellets of a shot are spread over */
+	float PelletSpread = 5.0f;
+
+	/** Damage dealt by each pellet, from the projectile class */
+	float HitDamage = 0.0f;
+
+	/** Loudness of the shot for AI perception */
+	float ShotLoudness = 1.0f;
+
+	/** Max range of shot AI perception noise */
+	float ShotNoiseRange = 3000.0f;
+
+	/** Number of bullets in a magazine */
+	int32 MagazineSize = 10;
+
+	/** Number of pellets launched by each shot */
+	uint8 PelletCount = 1;
+
+	/** Max number of full auto shots fired in a single frame */
+	uint8 MaxShotsPerFrame = 8;
+
+	/** Index of this block in the weapon stats subsystem */
+	uint8 WeaponId = ShooterWeaponIdNone;
+
+	/** If true, the weapon fires automatically at the refire rate */
+	bool bFullAuto = false;
+
+	/** If true, shots resolve as a trace instead of launching a projectile */
+	bool bHitscan = false;
+};
+
+static_assert(sizeof(FShooterWeaponStatBlock) == 64, "FShooterWeaponStatBlock should fit a single cache line");
+
+/**
+ *  Weapon table row copied out when the game starts, so pickups don't resolve table rows themselves
+ */
+struct FShooterWeaponTableEntry
+{
+	/** Mesh to display on the pickup */
+	TSoftObjectPtr<UStaticMesh> StaticMesh;
+
+	/** Weapon class to grant on pickup */
+	TSoftClassPtr<AShooterWeapon> WeaponToSpawn;
+};
+
+/**
+ *  Compiles weapon tuning into compact stat blocks indexed by a small weapon ID
+ *  Weapon classes in the weapon table get their IDs reserved in table order when the game starts, so they
+ *  match on every machine, but are only compiled once they've streamed in and been registered.
+ *  Other classes get the next free ID the first time they're registered. Those IDs depend on registration order,
+ *  so they're only meaningful on this machine and are never sent over the network
+ */
+UCLASS(Config=Game)
+class SIMPLESHOOTER_API UShooterWeaponStats : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+	/** Data table of FWeaponTableRow listing the weapons to reserve IDs for */
+	UPROPERTY(Config)
+	TSoftObjectPtr<UDataTable> WeaponTable;
+
+	/** Compiled stat blocks, indexed by weapon ID. Reserved up front so blocks never move */
+	TArray<FShooterWeaponStatBlock> StatBlocks;
+
+	/** Weapon IDs by class */
+	TMap<const UClass*, uint8> WeaponIds;
+
+	/** IDs reserved for the weapon table classes that haven't been compiled yet */
+	TMap<FSoftObjectPath, uint8> ReservedIds;
+
+	/** Number of IDs handed out to weapon table classes. IDs below this match on every machine */
+	int32 NumTableIds = 0;
+
+	/** Weapon table rows by row name */
+	TMap<FName, FShooterWeaponTableEntry> TableEntries;
+
+	/** Compiled weapon and projectile classes, kept alive for as long as their blocks point to them */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UClass>> CompiledClasses;
+
+public:
+
+	/** Reserves IDs for the weapons listed in the weapon table */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Compiles the stats of a weapon class if needed and returns its weapon ID, or ShooterWeaponIdNone if every ID is taken */
+	uint8 RegisterWeaponClass(TSubclassOf<AShooterWeapon> WeaponClass);
+
+	/** Returns the ID of a compiled or reserved weapon class, or ShooterWeaponIdNone */
+	uint8 FindWeaponId(const UClass* WeaponClass) const;
+
+	/** Returns true if a weapon ID came from the weapon table, so every machine agrees on it */
+	bool IsNetworkedWeaponId(uint8 WeaponId) const { return WeaponId < NumTableIds; };
+
+	/** Returns a row of the weapon table, or nullptr if there's no such row */
+	const FShooterWeaponTableEntry* FindTableEntry(FName RowName) const;
+
+	/** Returns the stat block of a weapon ID, or nullptr if it isn't compiled */
+	const FShooterWeaponStatBlock* GetStats(uint8 WeaponId) const;
+
+	/** Returns the weapon class of a weapon ID, or nullptr if it isn't compiled */
+	TSubclassOf<AShooterWeapon> GetWeaponClass(uint8 WeaponId) const;
+};